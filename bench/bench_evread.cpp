@@ -0,0 +1,143 @@
+// Reading of the input events by EventMonitor: batched read() of the
+// input_event arrays (ReadMode::BATCH) against one libevdev_next_event()
+// call per event (ReadMode::LIBEVDEV). Frames of both sticks and triggers
+// are written into a virtual gamepad (uinput) and read back, the read
+// syscalls are counted by /proc/thread-self/io (syscr). Needs the write
+// permission of /dev/uinput, the benchmark is skipped without it.
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <libevdev/libevdev-uinput.h>
+
+#include "logging.h"
+#include "evdevjoy.h"
+#include "eventmonitor.h"
+
+using namespace evdevjoy;
+
+static const std::size_t ROUNDS = 20000;
+static const unsigned int AXES[] = {ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ};
+
+// Read syscalls of the thread, 0 without the task I/O accounting
+static uint64_t read_syscalls()
+{
+    std::ifstream fin("/proc/thread-self/io");
+    std::string key;
+    uint64_t value;
+    while (fin >> key >> value) {
+        if (key == "syscr:") {
+            return value;
+        }
+    }
+    return 0;
+}
+
+class CountHandler : public EventHandler
+{
+  public:
+    std::size_t events = 0;
+    std::size_t frames = 0;
+
+    void on_event(std::size_t /*gamepad*/, const struct input_event &ev) override
+    {
+        events++;
+        if ((ev.type == EV_SYN) && (ev.code == SYN_REPORT)) {
+            frames++;
+        }
+    }
+    void on_frame(std::size_t /*gamepad*/, const struct input_event * /*events*/, std::size_t count) override
+    {
+        this->events += count;
+        frames++;
+    }
+    void on_removed(std::size_t /*gamepad*/) override {}
+};
+
+static struct libevdev_uinput* create_gamepad()
+{
+    struct libevdev *evdev = libevdev_new();
+    libevdev_set_name(evdev, "sdlxboxmap bench_evread");
+    libevdev_enable_event_type(evdev, EV_KEY);
+    libevdev_enable_event_code(evdev, EV_KEY, BTN_SOUTH, nullptr);
+    libevdev_enable_event_type(evdev, EV_ABS);
+    for (unsigned int code : AXES) {
+        struct input_absinfo absinfo = {};
+        absinfo.minimum = -32768;
+        absinfo.maximum = 32767;
+        libevdev_enable_event_code(evdev, EV_ABS, code, &absinfo);
+    }
+    struct libevdev_uinput *uinput = nullptr;
+    int rc = libevdev_uinput_create_from_device(evdev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uinput);
+    libevdev_free(evdev);
+    return (rc < 0) ? nullptr : uinput;
+}
+
+// Read syscalls of read_syscalls() itself
+static uint64_t get_syscalls_overhead()
+{
+    uint64_t first = read_syscalls();
+    return read_syscalls() - first;
+}
+
+static void run(const char *name, EventMonitor::ReadMode mode, std::size_t frames_per_wakeup,
+    struct libevdev_uinput *uinput, const EvdevJoystick &gamepad)
+{
+    uint64_t overhead = get_syscalls_overhead();
+    EventMonitor monitor(mode);
+    monitor.add(gamepad);
+    CountHandler handler;
+
+    std::chrono::duration<double> elapsed{0};
+    uint64_t syscalls = 0;
+    int value = 0;
+    for (std::size_t i=0; i < ROUNDS; i++) {
+        for (std::size_t frame=0; frame < frames_per_wakeup; frame++) {
+            value = (value + 977) % 32768;
+            for (unsigned int code : AXES) {
+                libevdev_uinput_write_event(uinput, EV_ABS, code, value);
+            }
+            libevdev_uinput_write_event(uinput, EV_SYN, SYN_REPORT, 0);
+        }
+
+        std::size_t expected = handler.frames + frames_per_wakeup;
+        uint64_t syscalls_start = read_syscalls();
+        auto start = std::chrono::steady_clock::now();
+        while (handler.frames < expected) {
+            if (!monitor.read_events(handler, 1000)) {
+                std::printf("  %s: timeout\n", name);
+                return;
+            }
+        }
+        elapsed += std::chrono::steady_clock::now() - start;
+        syscalls += read_syscalls() - syscalls_start - overhead;
+    }
+
+    std::printf("  %-36s %8.2f M events/s %10.2f syscalls/frame\n", name,
+        handler.events / elapsed.count() / 1e6, double(syscalls) / handler.frames);
+}
+
+int main()
+{
+    logging_init();
+
+    struct libevdev_uinput *uinput = create_gamepad();
+    if (uinput == nullptr) {
+        std::printf("uinput is not available, bench_evread skipped\n");
+        return 0;
+    }
+    // Wait for the device node
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    {
+        EvdevJoystick gamepad(libevdev_uinput_get_devnode(uinput));
+        for (std::size_t frames_per_wakeup : {1, 8}) {
+            std::printf("EventMonitor, 7 events per frame, %zu frames per wakeup (%zu wakeups)\n",
+                frames_per_wakeup, ROUNDS);
+            run("ReadMode::LIBEVDEV", EventMonitor::ReadMode::LIBEVDEV, frames_per_wakeup, uinput, gamepad);
+            run("ReadMode::BATCH", EventMonitor::ReadMode::BATCH, frames_per_wakeup, uinput, gamepad);
+        }
+    }
+    libevdev_uinput_destroy(uinput);
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Resolving of the template button names (MAP_BUTTON, MAP_ABS, AXISMAP
+// commands): lowercase copy and std::unordered_map lookup (previous
+// versions) against the compile time perfect hash of namehash.h.
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "benchutil.h"
+#include "evdevjoy.h"
+#include "namehash.h"
+#include "stringext.h"
+#include "tplprogram.h"
+
+using namespace evdevjoy;
+
+static const std::size_t ITERATIONS = 100000;
+
+// The table of the template compiler
+static constexpr auto &s_Names = sdlxboxmap::TemplateButtonNames;
+
+// Names as written in the templates, mixed case and a few unknown names
+static const std::vector<std::string_view> s_Queries = {
+    "A", "B", "X", "Y", "Back", "Guide", "Start", "TL", "TR", "LB", "RB",
+    "DU", "DD", "DL", "DR", "X1", "Y1", "X2", "Y2", "LT", "RT",
+    "leftx", "lefty", "rightx", "righty", "lefttrigger", "righttrigger",
+    "dpad_x", "dpad_y", "leftshoulder", "rightshoulder", "touchpad",
+    "unknown", "x3", "LeftStickButton"
+};
+
+int main()
+{
+    std::unordered_map<std::string_view, ControllerButton> name_map;
+    for (auto const &entry : s_Names) {
+        name_map.emplace(entry.name, entry.value);
+    }
+    static constexpr auto name_hash_map = make_name_map(s_Names);
+
+    bench::print_header("Button name lookup (" + std::to_string(ITERATIONS)
+        + " iterations, " + std::to_string(s_Queries.size()) + " names)");
+
+    volatile int sink = 0;
+
+    bench::Result lower_map = bench::measure(ITERATIONS, [&]() {
+        int sum = 0;
+        for (auto name : s_Queries) {
+            std::string name_lower = string::lower(name);
+            auto it = name_map.find(name_lower);
+            if (it != name_map.end()) {
+                sum += static_cast<int>(it->second);
+            }
+        }
+        sink = sink + sum;
+    });
+    bench::print_result("string::lower + unordered_map", lower_map);
+
+    bench::Result perfect_hash = bench::measure(ITERATIONS, [&]() {
+        int sum = 0;
+        for (auto name : s_Queries) {
+            const ControllerButton *button = name_hash_map.find(name);
+            if (button != nullptr) {
+                sum += static_cast<int>(*button);
+            }
+        }
+        sink = sink + sum;
+    });
+    bench::print_result("case insensitive perfect hash", perfect_hash);
+
+    return 0;
+}
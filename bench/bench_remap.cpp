@@ -0,0 +1,281 @@
+// In-process remapping (option --remap): frames of a synthetic Xbox 360
+// gamepad (both sticks moved, buttons and d-pad toggled) are translated by
+// RemapEngine into MemorySink, no device is needed. The latency is measured
+// from the time of the input event to the written output. AxisTransform of
+// 16 bit (fixed point kernel) and 8 bit (lookup table) axes is compared with
+// the scaling by the division. Before the benchmark the translation of the
+// axis split into two half axes and the scaling of the axis ranges are
+// checked.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include "benchutil.h"
+#include "logging.h"
+#include "evdevjoy.h"
+#include "devicelayout.h"
+#include "axistransform.h"
+#include "remapengine.h"
+#include "remaptable.h"
+
+using namespace evdevjoy;
+
+static const std::size_t ITERATIONS = 100000;
+static const char *X360_MAPPING = "030000005e0400008e02000010010000,X360 Controller,"
+    "a:b0,b:b1,back:b6,dpdown:h0.4,dpleft:h0.8,dpright:h0.2,dpup:h0.1,guide:b8,"
+    "leftshoulder:b4,leftstick:b9,lefttrigger:a2,leftx:a0,lefty:a1,rightshoulder:b5,"
+    "rightstick:b10,righttrigger:a5,rightx:a3,righty:a4,start:b7,x:b2,y:b3,";
+static const char *SPLIT_MAPPING = "030000005e0400008e02000010010000,Split axes,"
+    "dpleft:-a0,dpright:+a0,lefttrigger:+a1,";
+
+// Normalization, input range and output scaling by the divisions, as
+// RemapTable did before AxisTransform (neutral output out of the range)
+static int scale_by_division(const struct input_absinfo &absinfo, AxisRange input,
+    AxisRange output, int raw)
+{
+    int64_t scaled = (int64_t(raw) - absinfo.minimum) * (AxisTransform::AXIS_MAX - AxisTransform::AXIS_MIN) /
+        (int64_t(absinfo.maximum) - absinfo.minimum) + AxisTransform::AXIS_MIN;
+    int value = static_cast<int>(std::clamp<int64_t>(scaled, AxisTransform::AXIS_MIN, AxisTransform::AXIS_MAX));
+    if ((value < std::min(input.min, input.max)) || (value > std::max(input.min, input.max))) {
+        return 0;
+    }
+    return output.min + static_cast<int>(int64_t(value - input.min) *
+        (output.max - output.min) / (input.max - input.min));
+}
+
+static void bench_axis_transform(int minimum, int maximum)
+{
+    // The ranges are not known to the compiler, as for the device
+    volatile int opaque[] = {minimum, maximum, AxisTransform::AXIS_MIN, AxisTransform::AXIS_MAX,
+        0, AxisTransform::AXIS_MAX};
+    struct input_absinfo absinfo = {};
+    absinfo.minimum = opaque[0];
+    absinfo.maximum = opaque[1];
+    absinfo.flat = (maximum - minimum) / 32;
+    AxisRange input = {opaque[2], opaque[3]};
+    AxisRange output = {opaque[4], opaque[5]};
+    AxisTransform transform(absinfo, input, true, output);
+
+    const std::size_t VALUES = 1000;
+    std::vector<int> raw(VALUES);
+    for (std::size_t i=0; i < VALUES; i++) {
+        raw[i] = minimum + static_cast<int>((i * 977) % (int64_t(maximum) - minimum + 1));
+    }
+    volatile int sum = 0;
+    std::string range = std::to_string(minimum) + " ... " + std::to_string(maximum);
+
+    bench::Result result = bench::measure(ITERATIONS, [&]() {
+        int s = 0;
+        for (int value : raw) {
+            s += transform(value);
+        }
+        sum = s;
+    });
+    result.seconds /= VALUES;
+    bench::print_result(std::string(transform.has_lut() ? "AxisTransform LUT " : "AxisTransform kernel ")
+        + range, result);
+
+    result = bench::measure(ITERATIONS, [&]() {
+        int s = 0;
+        for (int value : raw) {
+            s += scale_by_division(absinfo, input, output, value);
+        }
+        sum = s;
+    });
+    result.seconds /= VALUES;
+    bench::print_result("division " + range, result);
+}
+
+// The half axis out of its range gives the neutral output, as ResetOutput()
+// of SDL_gamecontroller.c. Returns false and prints the difference when
+// the translation is not as expected.
+static bool check_half_axis_split()
+{
+    ControllerMapping mapping(SPLIT_MAPPING);
+    EvdevJoystick gamepad(make_device_layout(mapping.guid, mapping));
+    gamepad.set_mapping(mapping);
+    RemapTable table(gamepad);
+
+    struct Step
+    {
+        unsigned int code;
+        int value;
+        ControllerButton output;
+        int expected;
+    };
+    const Step steps[] = {
+        {ABS_X, -32768, ControllerButton::BUTTON_DPAD_LEFT, 1},
+        {ABS_X, -32768, ControllerButton::BUTTON_DPAD_RIGHT, 0},
+        {ABS_X, 32767, ControllerButton::BUTTON_DPAD_LEFT, 0},
+        {ABS_X, 32767, ControllerButton::BUTTON_DPAD_RIGHT, 1},
+        {ABS_X, 0, ControllerButton::BUTTON_DPAD_RIGHT, 0},
+        {ABS_Y, 32767, ControllerButton::AXIS_TRIGGERLEFT, 32767},
+        {ABS_Y, -32768, ControllerButton::AXIS_TRIGGERLEFT, 0},
+    };
+    bool ok = true;
+    for (const Step &step : steps) {
+        struct input_event ev = {};
+        ev.type = EV_ABS;
+        ev.code = step.code;
+        ev.value = step.value;
+        int value = -1;
+        table.translate(ev, [&](ControllerButton output, bool, int output_value) {
+            if (output == step.output) {
+                value = output_value;
+            }
+        });
+        if (value != step.expected) {
+            std::printf("Half axis split: axis %u = %d gives %d, expected %d\n",
+                step.code, step.value, value, step.expected);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Output scaling of SDL_gamecontroller.c, in float
+static int scale_as_sdl(AxisRange input, AxisRange output, int value)
+{
+    float normalized_value = (float)(value - input.min) / (input.max - input.min);
+    return output.min + (int)(normalized_value * (output.max - output.min));
+}
+
+// Boundary values of the ranges used by SDL bindings (full, half and
+// inverted axis) are pinned, the other values differ from SDL at most by 1
+// (rounding of the float). Returns false and prints the difference
+// otherwise.
+static bool check_axis_scaling()
+{
+    const AxisRange FULL = {AxisTransform::AXIS_MIN, AxisTransform::AXIS_MAX};
+    const AxisRange FULL_INVERTED = {AxisTransform::AXIS_MAX, AxisTransform::AXIS_MIN};
+    const AxisRange POSITIVE = {0, AxisTransform::AXIS_MAX};
+    const AxisRange NEGATIVE = {0, AxisTransform::AXIS_MIN};
+
+    struct Pin
+    {
+        AxisRange input;
+        AxisRange output;
+        int value;
+        int expected;
+    };
+    const Pin pins[] = {
+        {FULL, POSITIVE, -32768, 0},
+        {FULL, POSITIVE, -32767, 0},
+        {FULL, POSITIVE, -1, 16383},
+        {FULL, POSITIVE, 0, 16383},
+        {FULL, POSITIVE, 1, 16384},
+        {FULL, POSITIVE, 32766, 32766},
+        {FULL, POSITIVE, 32767, 32767},
+        {FULL_INVERTED, POSITIVE, 32767, 0},
+        {FULL_INVERTED, POSITIVE, 0, 16383},
+        {FULL_INVERTED, POSITIVE, 1, 16382},
+        {FULL_INVERTED, POSITIVE, -32767, 32766},
+        {FULL_INVERTED, POSITIVE, -32768, 32767},
+        {POSITIVE, FULL, 0, -32768},
+        {POSITIVE, FULL, 1, -32766},
+        {POSITIVE, FULL, 32766, 32764},     // 65532.99997, float of SDL 32765
+        {POSITIVE, FULL, 32767, 32767},
+        {NEGATIVE, FULL_INVERTED, 0, 32767},
+        {NEGATIVE, FULL_INVERTED, -1, 32766},
+        {NEGATIVE, FULL_INVERTED, -32767, -32766},
+        {NEGATIVE, FULL_INVERTED, -32768, -32768},
+    };
+
+    // Invalid absinfo, the raw value is the SDL value
+    struct input_absinfo absinfo = {};
+    bool ok = true;
+    for (const Pin &pin : pins) {
+        int value = AxisTransform(absinfo, pin.input, true, pin.output)(pin.value);
+        if (value != pin.expected) {
+            std::printf("Axis scaling %d ... %d to %d ... %d: %d gives %d, expected %d\n",
+                pin.input.min, pin.input.max, pin.output.min, pin.output.max,
+                pin.value, value, pin.expected);
+            ok = false;
+        }
+    }
+
+    const AxisRange ranges[] = {FULL, FULL_INVERTED, POSITIVE, NEGATIVE};
+    for (AxisRange input : ranges) {
+        for (AxisRange output : ranges) {
+            AxisTransform transform(absinfo, input, true, output);
+            for (int value = std::min(input.min, input.max); value <= std::max(input.min, input.max); value++) {
+                int result = transform(value);
+                int expected = scale_as_sdl(input, output, value);
+                if (std::abs(result - expected) > 1) {
+                    std::printf("Axis scaling %d ... %d to %d ... %d: %d gives %d, SDL %d\n",
+                        input.min, input.max, output.min, output.max, value, result, expected);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static struct input_event make_event(unsigned int type, unsigned int code, int value)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    struct input_event ev = {};
+    ev.input_event_sec = now.tv_sec;
+    ev.input_event_usec = now.tv_nsec / 1000;
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+    return ev;
+}
+
+int main()
+{
+    logging_init();
+
+    if (!check_half_axis_split() || !check_axis_scaling()) {
+        return 1;
+    }
+
+    ControllerMapping mapping(X360_MAPPING);
+    EvdevJoystick gamepad(make_device_layout(mapping.guid, mapping));
+    gamepad.set_mapping(mapping);
+
+    MemorySink sink;
+    RemapEngine engine(sink);
+    engine.add(gamepad);
+
+    // One frame: 4 stick axes, a trigger, a button and the hat
+    std::size_t i_frame = 0;
+    auto frame = [&]() {
+        int v = static_cast<int>((i_frame * 977) % 65536) - 32768;
+        int toggle = i_frame % 2;
+        engine.on_event(0, make_event(EV_ABS, ABS_X, v));
+        engine.on_event(0, make_event(EV_ABS, ABS_Y, -v - 1));
+        engine.on_event(0, make_event(EV_ABS, ABS_RX, v / 2));
+        engine.on_event(0, make_event(EV_ABS, ABS_RY, v / 3));
+        engine.on_event(0, make_event(EV_ABS, ABS_Z, v));
+        engine.on_event(0, make_event(EV_KEY, BTN_SOUTH, toggle));
+        engine.on_event(0, make_event(EV_ABS, ABS_HAT0X, toggle ? -1 : 1));
+        engine.on_event(0, make_event(EV_SYN, SYN_REPORT, 0));
+        i_frame++;
+        sink.events.clear();
+    };
+
+    bench::print_header("RemapEngine, 7 input events per frame ("
+        + std::to_string(ITERATIONS) + " frames)");
+    bench::Result result = bench::measure(ITERATIONS, frame);
+    bench::print_result("RemapEngine::on_event (frame)", result);
+
+    const LatencyStats &latency = engine.get_latency();
+    std::printf("  %llu output events, %.1f M events/s\n",
+        static_cast<unsigned long long>(latency.get_count()),
+        latency.get_count() / (result.seconds * ITERATIONS) / 1e6);
+    std::cout << "  ";
+    latency.print(std::cout);
+
+    bench::print_header("Axis to trigger, per value");
+    bench_axis_transform(-32768, 32767);
+    bench_axis_transform(0, 255);
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Startup cost of the mapping database: eager parsing of all mappings
+// (behaviour of the previous versions) against the lazy, guid filtered mode
+// used by MainApp::init_gamepads().
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchutil.h"
+#include "logging.h"
+#include "evdevjoy.h"
+#include "joymapdb.h"
+
+using namespace evdevjoy;
+
+static const std::size_t ITERATIONS = 200;
+
+// Gamepads "connected" during the benchmark
+static const std::vector<Guid> s_ConnectedGuids = {
+    Guid(0x030000005e040000ULL, 0x8e02000010010000ULL),
+    Guid(0x030000004c050000ULL, 0xc405000011010000ULL)
+};
+
+int main()
+{
+    logging_init();
+
+    std::string db_text;
+    for (int i=0; s_ControllerMappings[i] != NULL; i++) {
+        Guid guid;
+        // skip "xinput" pseudo guid
+        if (!Guid::from_string(std::string_view(s_ControllerMappings[i]).substr(0, Guid::STRING_LENGTH), guid)) {
+            continue;
+        }
+        db_text += s_ControllerMappings[i];
+        db_text += '\n';
+    }
+
+    bench::print_header("Mapping database startup (" + std::to_string(ITERATIONS)
+        + " iterations, " + std::to_string(s_ConnectedGuids.size()) + " gamepads)");
+
+    bench::Result eager = bench::measure(ITERATIONS, [&]() {
+        SDLJoyMapping joymap;
+        std::istringstream iss(db_text);
+        joymap.add_sdl_mapping(iss, ControllerMapping::PRIORITY_DEFAULT);
+        for (auto const &guid : s_ConnectedGuids) {
+            joymap.get_mapping(guid);
+        }
+    });
+    bench::print_result("eager, parse all text mappings", eager);
+
+    bench::Result eager_view = bench::measure(ITERATIONS, [&]() {
+        SDLJoyMapping joymap;
+        joymap.add_sdl_mapping(std::string_view(db_text), ControllerMapping::PRIORITY_DEFAULT);
+        for (auto const &guid : s_ConnectedGuids) {
+            joymap.get_mapping(guid);
+        }
+    });
+    bench::print_result("eager, string_view text parser", eager_view);
+
+    bench::Result lazy_text = bench::measure(ITERATIONS, [&]() {
+        SDLJoyMapping joymap;
+        joymap.set_guid_filter(s_ConnectedGuids);
+        std::istringstream iss(db_text);
+        joymap.add_sdl_mapping(iss, ControllerMapping::PRIORITY_DEFAULT);
+        for (auto const &guid : s_ConnectedGuids) {
+            joymap.get_mapping(guid);
+        }
+    });
+    bench::print_result("lazy, guid filtered text mappings", lazy_text);
+
+    bench::Result lazy_view = bench::measure(ITERATIONS, [&]() {
+        SDLJoyMapping joymap;
+        joymap.set_guid_filter(s_ConnectedGuids);
+        joymap.add_sdl_mapping(std::string_view(db_text), ControllerMapping::PRIORITY_DEFAULT);
+        for (auto const &guid : s_ConnectedGuids) {
+            joymap.get_mapping(guid);
+        }
+    });
+    bench::print_result("lazy, string_view text parser", lazy_view);
+
+    bench::Result lazy_internal = bench::measure(ITERATIONS, [&]() {
+        SDLJoyMapping joymap;
+        joymap.set_guid_filter(s_ConnectedGuids);
+        joymap.add_default_mapping();
+        for (auto const &guid : s_ConnectedGuids) {
+            joymap.get_mapping(guid);
+        }
+    });
+    bench::print_result("lazy, compiled internal database", lazy_internal);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Enumeration of the gamepads from sysfs (option --sysfs): the fake tree of
+// input devices is created in a temporary directory, or the root is given as
+// the first argument (e.g. /sys).
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "benchutil.h"
+#include "logging.h"
+#include "evdevjoy.h"
+#include "sysfsinput.h"
+
+using namespace evdevjoy;
+namespace fs = std::filesystem;
+
+static const std::size_t ITERATIONS = 200;
+static const int N_GAMEPADS = 16;
+static const int N_OTHER = 16;
+
+static void write_file(const fs::path &filename, const std::string &value)
+{
+    std::ofstream fout(filename);
+    fout << value << '\n';
+}
+
+static void make_device(const fs::path &root, int number, bool gamepad)
+{
+    fs::path device = root / "class" / "input" / ("event" + std::to_string(number)) / "device";
+    fs::create_directories(device / "id");
+    fs::create_directories(device / "capabilities");
+
+    write_file(device / "id" / "bustype", "0003");
+    write_file(device / "id" / "vendor", gamepad ? "045e" : "046d");
+    write_file(device / "id" / "product", gamepad ? "028e" : "c52b");
+    write_file(device / "id" / "version", "0110");
+    if (gamepad) {
+        write_file(device / "name", "Microsoft X-Box 360 pad");
+        write_file(device / "capabilities" / "key", "7fdb000000000000 0 0 0 0");
+        write_file(device / "capabilities" / "abs", "3003f");
+    } else {
+        write_file(device / "name", "Logitech USB Receiver Mouse");
+        write_file(device / "capabilities" / "key", "1f0000 0 0 0 0");
+        write_file(device / "capabilities" / "abs", "0");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    logging_init();
+
+    fs::path root;
+    bool fake_tree = (argc < 2);
+    if (fake_tree) {
+        char tmp_template[] = "/tmp/bench_sysfs.XXXXXX";
+        if (mkdtemp(tmp_template) == nullptr) {
+            std::perror("mkdtemp");
+            return 1;
+        }
+        root = tmp_template;
+        for (int i=0; i < N_GAMEPADS + N_OTHER; i++) {
+            make_device(root, i, (i % 2) == 0);
+        }
+    } else {
+        root = argv[1];
+    }
+
+    SysfsInput sysfs(root.u8string());
+    bench::print_header("Gamepad enumeration from " + root.u8string() + " ("
+        + std::to_string(sysfs.get_joysticks().size()) + " gamepads, "
+        + std::to_string(ITERATIONS) + " iterations)");
+
+    bench::Result enumerate = bench::measure(ITERATIONS, [&]() {
+        sysfs.get_joysticks();
+    });
+    bench::print_result("SysfsInput::get_joysticks", enumerate);
+
+    bench::Result gamepads = bench::measure(ITERATIONS, [&]() {
+        for (auto const &descriptor : sysfs.get_joysticks()) {
+            EvdevJoystick gamepad(descriptor);
+        }
+    });
+    bench::print_result("get_joysticks + EvdevJoystick(descriptor)", gamepads);
+
+    if (fake_tree) {
+        fs::remove_all(root);
+    }
+    return 0;
+}
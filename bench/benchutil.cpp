@@ -0,0 +1,63 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "benchutil.h"
+
+static std::atomic<uint64_t> s_alloc_count{0};
+static std::atomic<uint64_t> s_alloc_bytes{0};
+
+void* operator new(std::size_t size)
+{
+    s_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    s_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *ptr = std::malloc(size ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace bench {
+
+uint64_t alloc_count()
+{
+    return s_alloc_count.load(std::memory_order_relaxed);
+}
+
+uint64_t alloc_bytes()
+{
+    return s_alloc_bytes.load(std::memory_order_relaxed);
+}
+
+void print_header(const std::string &title)
+{
+    std::printf("%s\n", title.c_str());
+    std::printf("  %-40s %14s %12s %14s\n", "", "time/iter", "allocs/iter", "bytes/iter");
+}
+
+void print_result(const std::string &name, const Result &result)
+{
+    double value = result.seconds * 1e6;
+    const char *unit = "us";
+    if (value < 1.0) {
+        value *= 1000.0;
+        unit = "ns";
+    }
+    std::printf("  %-40s %11.2f %s %12llu %14llu\n", name.c_str(), value, unit,
+        static_cast<unsigned long long>(result.allocs),
+        static_cast<unsigned long long>(result.bytes));
+}
+
+} // namespace bench
@@ -0,0 +1,48 @@
+#ifndef __BENCHUTIL_H
+#define __BENCHUTIL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bench {
+
+// Number of calls of the global operator new since program start
+uint64_t alloc_count();
+// Number of bytes requested by the global operator new since program start
+uint64_t alloc_bytes();
+
+struct Result
+{
+    double seconds;
+    uint64_t allocs;
+    uint64_t bytes;
+};
+
+// Run fn() iterations times, returns the average time and allocation
+// counts of one iteration
+template <typename Fn>
+Result measure(std::size_t iterations, Fn fn)
+{
+    uint64_t allocs = alloc_count();
+    uint64_t bytes = alloc_bytes();
+    auto start = std::chrono::steady_clock::now();
+
+    for (std::size_t i=0; i < iterations; i++) {
+        fn();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return Result{
+        elapsed.count() / iterations,
+        (alloc_count() - allocs) / iterations,
+        (alloc_bytes() - bytes) / iterations
+    };
+}
+
+void print_header(const std::string &title);
+void print_result(const std::string &name, const Result &result);
+
+} // namespace bench
+#endif
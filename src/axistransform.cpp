@@ -0,0 +1,46 @@
+#include "axistransform.h"
+
+namespace evdevjoy {
+
+AxisTransform::AxisTransform(const struct input_absinfo &absinfo, AxisRange input,
+    bool output_axis, AxisRange output)
+{
+    if (absinfo.maximum > absinfo.minimum) {
+        // The same correction as SDL_sysjoystick.c of Linux, values of the
+        // dead zone are 0. Noise of the centered axis (fuzz) is in the dead
+        // zone too, at least one raw step stays out of it.
+        int64_t range = int64_t(absinfo.maximum) - absinfo.minimum;
+        int64_t flat = std::clamp<int64_t>(std::max(absinfo.flat, absinfo.fuzz), 0, (range - 1) / 4);
+        int64_t center2 = int64_t(absinfo.maximum) + absinfo.minimum;
+        normalize = true;
+        raw_min = absinfo.minimum;
+        raw_max = absinfo.maximum;
+        dead_low = center2 - 2 * flat;
+        dead_high = center2 + 2 * flat;
+        scale = (int64_t(1) << (NORMALIZE_SHIFT + 15)) / (range - 4 * flat);
+    }
+
+    in_low = std::min(input.min, input.max);
+    in_high = std::max(input.min, input.max);
+    in_min = input.min;
+    if (!output_axis) {
+        threshold = input.min + (input.max - input.min) / 2;
+        this->output = (input.max < input.min) ? Output::BUTTON_INVERTED : Output::BUTTON;
+    } else if ((input.min != output.min) || (input.max != output.max)) {
+        int64_t in_range = std::abs(int64_t(input.max) - input.min);
+        int64_t out_range = int64_t(output.max) - output.min;
+        this->output = Output::SCALE;
+        out_min = output.min;
+        out_sign = (out_range < 0) ? -1 : 1;
+        factor = ((std::abs(out_range) << SCALE_SHIFT) + in_range - 1) / in_range;
+    }
+
+    if (normalize && (int64_t(raw_max) - raw_min < LUT_MAX_SIZE)) {
+        lut.resize(raw_max - raw_min + 1);
+        for (int raw = raw_min; raw <= raw_max; raw++) {
+            lut[raw - raw_min] = compute(raw);
+        }
+    }
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,117 @@
+#ifndef __AXISTRANSFORM_H
+#define __AXISTRANSFORM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <linux/input.h>
+
+namespace evdevjoy {
+
+struct AxisRange
+{
+    int min;
+    int max;
+};
+
+// Raw value of the device axis to the value of one binding, precomputed
+// from input_absinfo of the axis and the ButtonBinding:
+//
+//   1. normalization to SDL range -32768 ... 32767 with the dead zone
+//      around the center (flat, at least fuzz), the fixed point correction
+//      of the SDL Linux joystick driver
+//   2. input range of the binding (half axis, swapped when inverted),
+//      the value out of it gives the neutral output (0), as ResetOutput()
+//      of SDL_gamecontroller.c
+//   3. scaling to the output axis range or the threshold of the button,
+//      the exact quotient truncated toward zero as SDL does. SDL computes
+//      it in float, its rounding error gives 1 more or less for some values
+//      near the end of the long ranges (at most 63 of 65536), these are
+//      not reproduced.
+//
+// Axes with at most LUT_MAX_SIZE values (8 and 10 bit) use the lookup table
+// of the results, other axes the integer kernel of the three steps, there
+// is no division and no floating point per event.
+class AxisTransform
+{
+  public:
+    static const int AXIS_MIN = -32768;
+    static const int AXIS_MAX = 32767;
+    static const int LUT_MAX_SIZE = 1024;
+
+    AxisTransform() = default;
+    // Invalid absinfo (maximum <= minimum) takes the raw value as SDL value.
+    // output_axis false for the button, the result is 0/1.
+    AxisTransform(const struct input_absinfo &absinfo, AxisRange input,
+        bool output_axis, AxisRange output);
+
+    int operator()(int raw) const {
+        if (!lut.empty()) {
+            return lut[std::clamp(raw, raw_min, raw_max) - raw_min];
+        }
+        return compute(raw);
+    }
+    // The kernel without the lookup table
+    int compute(int raw) const {
+        int64_t value = raw;
+        if (normalize) {
+            // Distance below and above the dead zone, one of them is 0
+            value = 2 * int64_t(std::clamp(raw, raw_min, raw_max));
+            int64_t below = std::min<int64_t>(value - dead_low, 0);
+            int64_t above = std::max<int64_t>(value - dead_high, 0);
+            value = ((below + above) * scale) >> NORMALIZE_SHIFT;
+        }
+        int sdl_value = static_cast<int>(std::clamp<int64_t>(value, AXIS_MIN, AXIS_MAX));
+        if ((sdl_value < in_low) || (sdl_value > in_high)) {
+            // Released button, centered axis or released trigger, 0 is in
+            // every output range
+            return 0;
+        }
+
+        switch (output) {
+            case Output::SCALE:
+                value = (std::abs(int64_t(sdl_value) - in_min) * factor) >> SCALE_SHIFT;
+                return out_min + out_sign * static_cast<int>(value);
+            case Output::BUTTON:
+                return sdl_value >= threshold;
+            case Output::BUTTON_INVERTED:
+                return sdl_value <= threshold;
+            default:
+                return sdl_value;
+        }
+    }
+    bool has_lut() const { return !lut.empty(); }
+
+  protected:
+    enum class Output : uint8_t { IDENTITY, SCALE, BUTTON, BUTTON_INVERTED };
+    static const int NORMALIZE_SHIFT = 29;
+    static const int SCALE_SHIFT = 32;
+
+    // Normalization, doubled raw value: below dead_low and above dead_high
+    // scaled by the Q44 factor (Q28 of SDL rounds the end of long axes),
+    // between them 0
+    bool normalize = false;
+    int64_t dead_low = 0;
+    int64_t dead_high = 0;
+    int64_t scale = 0;
+    // Input range of the binding, low <= high
+    int in_low = AXIS_MIN;
+    int in_high = AXIS_MAX;
+    // Output: out_min + out_sign * |value - in_min| * factor, or the
+    // threshold. The Q32 factor |output| / |input| is rounded up, the
+    // product truncates to the exact quotient for input ranges up to 65536.
+    Output output = Output::IDENTITY;
+    int in_min = AXIS_MIN;
+    int out_min = AXIS_MIN;
+    int out_sign = 1;
+    int64_t factor = 0;
+    int threshold = 0;
+
+    int raw_min = 0;            // range of the normalized axis
+    int raw_max = 0;
+    std::vector<int> lut;       // results of raw_min ... raw_max
+};
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,263 @@
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "bindb.h"
+#include "platform.h"
+
+namespace evdevjoy {
+
+BinaryMappingDb::BinaryMappingDb(const std::string &filename) :
+    filename(filename)
+{
+    using namespace bindb;
+
+    try {
+        file = platform::MappedFile(filename);
+    } catch (const std::system_error &e) {
+        LOG(ERROR) << "BinaryMappingDb: " << e.what();
+        throw std::runtime_error(e.what());
+    }
+    init();
+}
+
+BinaryMappingDb::BinaryMappingDb(const std::string &filename, platform::MappedFile &&file) :
+    filename(filename),
+    file(std::move(file))
+{
+    init();
+}
+
+void BinaryMappingDb::init()
+{
+    using namespace bindb;
+
+    if (!is_binary_db(file.view()) || (file.size() < sizeof(FileHeader))) {
+        LOG(ERROR) << "BinaryMappingDb: not a binary mapping database: " << filename;
+        throw std::runtime_error("Not a binary mapping database: " + filename);
+    }
+
+    header = reinterpret_cast<const FileHeader*>(file.data());
+    if (header->byte_order != BYTE_ORDER_MARK) {
+        LOG(ERROR) << "BinaryMappingDb: database created on machine with different byte order: " 
+            << filename;
+        throw std::runtime_error("Unsupported byte order of mapping database: " + filename);
+    }
+    if (header->version != VERSION) {
+        LOG(ERROR) << "BinaryMappingDb: unsupported version " << header->version
+            << " of database: " << filename;
+        throw std::runtime_error("Unsupported version of mapping database: " + filename);
+    }
+
+    uint64_t index_end = uint64_t(header->index_offset) 
+        + uint64_t(header->mapping_count) * sizeof(IndexEntry);
+    uint64_t bindings_end = uint64_t(header->bindings_offset) 
+        + uint64_t(header->binding_count) * sizeof(BindingRecord);
+    uint64_t strings_end = uint64_t(header->strings_offset) + header->strings_size;
+
+    if ((index_end > file.size()) || (bindings_end > file.size()) || 
+        (strings_end > file.size()) || 
+        (header->index_offset % alignof(IndexEntry) != 0) ||
+        (header->bindings_offset % alignof(BindingRecord) != 0))
+    {
+        LOG(ERROR) << "BinaryMappingDb: corrupted database: " << filename;
+        throw std::runtime_error("Corrupted mapping database: " + filename);
+    }
+
+    index = reinterpret_cast<const IndexEntry*>(file.data() + header->index_offset);
+    bindings = reinterpret_cast<const BindingRecord*>(file.data() + header->bindings_offset);
+    strings = file.data() + header->strings_offset;
+
+    LOG(INFO) << "BinaryMappingDb: loaded " << header->mapping_count 
+        << " mappings from: " << filename;
+}
+
+bool BinaryMappingDb::is_binary_db(std::string_view data)
+{
+    return (data.size() >= sizeof(bindb::MAGIC)) && 
+        (std::memcmp(data.data(), bindb::MAGIC, sizeof(bindb::MAGIC)) == 0);
+}
+
+const bindb::IndexEntry* BinaryMappingDb::find(Guid const &guid) const
+{
+    const bindb::IndexEntry *first = index;
+    const bindb::IndexEntry *last = index + header->mapping_count;
+    const bindb::IndexEntry *it = std::lower_bound(first, last, guid,
+        [](const bindb::IndexEntry &entry, const Guid &key) {
+            return Guid::from_bytes(entry.guid) < key;
+        });
+
+    if ((it == last) || (Guid::from_bytes(it->guid) != guid)) {
+        return nullptr;
+    }
+
+    if ((uint64_t(it->first_binding) + it->binding_count > header->binding_count) ||
+        (uint64_t(it->name_offset) + it->name_length > header->strings_size)) 
+    {
+        LOG(ERROR) << "BinaryMappingDb: corrupted entry for guid: " << guid.to_string();
+        return nullptr;
+    }
+    return it;
+}
+
+std::string_view BinaryMappingDb::get_name(const bindb::IndexEntry &entry) const
+{
+    return std::string_view(strings + entry.name_offset, entry.name_length);
+}
+
+const bindb::BindingRecord* BinaryMappingDb::get_bindings(const bindb::IndexEntry &entry) const
+{
+    return bindings + entry.first_binding;
+}
+
+ButtonBinding BinaryMappingDb::to_button_binding(const bindb::BindingRecord &record)
+{
+    ButtonBinding binding = {};
+
+    binding.input_type = static_cast<BindType>(record.input_type);
+    binding.input.axis_type = static_cast<ControllerAxisType>(record.input_axis_type);
+    binding.input.invert_input = (record.flags & bindb::FLAG_INVERT_INPUT) != 0;
+    binding.input.hat_mask = record.hat_mask;
+    if (binding.input_type == BindType::BINDTYPE_AXIS) {
+        binding.input.axis = record.index;
+    } else if (binding.input_type == BindType::BINDTYPE_HAT) {
+        binding.input.hat = record.index;
+    } else {
+        binding.input.button = record.index;
+    }
+
+    ControllerButton output = static_cast<ControllerButton>(record.output);
+    binding.output_type = (output > ControllerButton::BUTTON_MAX) ? 
+        BindType::BINDTYPE_AXIS : BindType::BINDTYPE_BUTTON;
+    if (binding.output_type == BindType::BINDTYPE_AXIS) {
+        binding.output.axis = output;
+    } else {
+        binding.output.button = output;
+    }
+    binding.output.axis_type = static_cast<ControllerAxisType>(record.output_axis_type);
+    return binding;
+}
+
+void BinaryMappingDb::to_controller_mapping(const bindb::IndexEntry &entry, 
+        ControllerMapping &mapping) const
+{
+    mapping.guid = Guid::from_bytes(entry.guid);
+    mapping.name = get_name(entry);
+    mapping.priority = ControllerMapping::PRIORITY_API;
+    mapping.button_binding.clear();
+
+    const bindb::BindingRecord *records = get_bindings(entry);
+    for (int i=0; i < entry.binding_count; i++) {
+        mapping.set_button_binding(to_button_binding(records[i]));
+    }
+}
+
+static bindb::BindingRecord to_binding_record(const ButtonBinding &binding)
+{
+    bindb::BindingRecord record = {};
+
+    if (binding.output_type == BindType::BINDTYPE_AXIS) {
+        record.output = static_cast<uint8_t>(binding.output.axis);
+    } else {
+        record.output = static_cast<uint8_t>(binding.output.button);
+    }
+    record.output_axis_type = static_cast<uint8_t>(binding.output.axis_type);
+    record.input_type = static_cast<uint8_t>(binding.input_type);
+    record.input_axis_type = static_cast<uint8_t>(binding.input.axis_type);
+    record.flags = binding.input.invert_input ? bindb::FLAG_INVERT_INPUT : 0;
+    record.hat_mask = static_cast<uint8_t>(binding.input.hat_mask);
+    if (binding.input_type == BindType::BINDTYPE_AXIS) {
+        record.index = static_cast<uint16_t>(binding.input.axis);
+    } else if (binding.input_type == BindType::BINDTYPE_HAT) {
+        record.index = static_cast<uint16_t>(binding.input.hat);
+    } else {
+        record.index = static_cast<uint16_t>(binding.input.button);
+    }
+    return record;
+}
+
+std::size_t BinaryMappingDb::compile(std::istream &is, std::ostream &os)
+{
+    using namespace bindb;
+
+    // Same rules as SDLJoyMapping::add_sdl_mapping(), later mapping of the
+    // same guid replaces the previous one, std::map keeps them sorted
+    std::map<Guid, ControllerMapping> mapping_db;
+    std::string line;
+    std::size_t line_number = 0;
+
+    while (std::getline(is, line)) {
+        line_number++;
+        if (!line.empty() && (line.back() == '\r')) {
+            line.pop_back();
+        }
+        if (line.empty() || (line[0] == '#')) {
+            continue;
+        }
+
+        try {
+            ControllerMapping mapping(line, ControllerMapping::PRIORITY_API);
+            if ((mapping.platform != "") && (mapping.platform != platform::get_platform())) {
+                continue;
+            }
+
+            Guid guid = mapping.guid;
+            mapping_db[guid] = std::move(mapping);
+        } catch (const std::runtime_error &e) {
+            LOG(WARNING) << "BinaryMappingDb::compile: skip line " << line_number;
+        }
+    }
+
+    std::vector<IndexEntry> index;
+    std::vector<BindingRecord> records;
+    std::string strings;
+
+    index.reserve(mapping_db.size());
+    for (auto const &item : mapping_db) {
+        const ControllerMapping &mapping = item.second;
+        IndexEntry entry = {};
+
+        item.first.to_bytes(entry.guid);
+        entry.name_offset = static_cast<uint32_t>(strings.size());
+        entry.name_length = static_cast<uint16_t>(std::min<std::size_t>(mapping.name.size(), UINT16_MAX));
+        entry.first_binding = static_cast<uint32_t>(records.size());
+        entry.binding_count = static_cast<uint16_t>(mapping.button_binding.size());
+        strings.append(mapping.name, 0, entry.name_length);
+
+        mapping.button_binding.for_each([&records](const ButtonBinding &binding) {
+            records.push_back(to_binding_record(binding));
+        });
+        index.push_back(entry);
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.mapping_count = static_cast<uint32_t>(index.size());
+    header.binding_count = static_cast<uint32_t>(records.size());
+    header.strings_size = static_cast<uint32_t>(strings.size());
+    header.index_offset = sizeof(FileHeader);
+    header.bindings_offset = header.index_offset + header.mapping_count * sizeof(IndexEntry);
+    header.strings_offset = header.bindings_offset + header.binding_count * sizeof(BindingRecord);
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(IndexEntry));
+    os.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(BindingRecord));
+    os.write(strings.data(), strings.size());
+
+    return index.size();
+}
+
+} // namespace evdevjoy
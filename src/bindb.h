@@ -0,0 +1,116 @@
+#ifndef __BINDB_H
+#define __BINDB_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+#include "evdevjoy.h"
+#include "mmapfile.h"
+
+namespace evdevjoy {
+
+// Compact binary mapping database. The file is memory mapped and used
+// without parsing:
+//
+//   FileHeader
+//   IndexEntry[mapping_count]      sorted by guid
+//   BindingRecord[binding_count]   bindings of all entries
+//   char strings[strings_size]     names, not null terminated
+//
+// All integers are stored in the byte order of the machine which created the
+// file, the byte_order field is used to detect foreign files.
+namespace bindb {
+    const char MAGIC[8] = {'S', 'X', 'B', 'M', 'A', 'P', 'D', 'B'};
+    const uint32_t VERSION = 1;
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t mapping_count;
+        uint32_t binding_count;
+        uint32_t strings_size;
+        uint32_t index_offset;
+        uint32_t bindings_offset;
+        uint32_t strings_offset;
+    };
+
+    struct IndexEntry
+    {
+        uint8_t guid[16];
+        uint32_t name_offset;
+        uint16_t name_length;
+        uint16_t binding_count;
+        uint32_t first_binding;
+        uint32_t reserved;
+    };
+
+    const uint8_t FLAG_INVERT_INPUT = 0x01;
+
+    struct BindingRecord
+    {
+        uint8_t output;             // ControllerButton
+        uint8_t input_type;         // BindType
+        uint8_t input_axis_type;    // ControllerAxisType
+        uint8_t flags;              // FLAG_*
+        uint16_t index;             // button, axis or hat number
+        uint8_t hat_mask;
+        uint8_t output_axis_type;   // ControllerAxisType
+    };
+
+    static_assert(sizeof(FileHeader) == 40, "Unexpected size of bindb::FileHeader");
+    static_assert(sizeof(IndexEntry) == 32, "Unexpected size of bindb::IndexEntry");
+    static_assert(sizeof(BindingRecord) == 8, "Unexpected size of bindb::BindingRecord");
+}
+
+class BinaryMappingDb
+{
+  public:
+    // Map the database file, throws std::runtime_error when the file cannot
+    // be opened or has unexpected format
+    explicit BinaryMappingDb(const std::string &filename);
+    // Use already mapped file content
+    BinaryMappingDb(const std::string &filename, platform::MappedFile &&file);
+
+    // Check the magic of the file content
+    static bool is_binary_db(std::string_view data);
+
+    // Compile text SDL mappings (one mapping per line) into binary database.
+    // Returns number of written mappings.
+    static std::size_t compile(std::istream &is, std::ostream &os);
+
+    // Binary search of the guid, nullptr if not found
+    const bindb::IndexEntry* find(Guid const &guid) const;
+    std::string_view get_name(const bindb::IndexEntry &entry) const;
+    const bindb::BindingRecord* get_bindings(const bindb::IndexEntry &entry) const;
+    std::size_t size() const { return header->mapping_count; }
+    // Guid of the i-th entry, entries are sorted by guid
+    Guid get_guid(std::size_t i) const { return Guid::from_bytes(index[i].guid); }
+
+    static ButtonBinding to_button_binding(const bindb::BindingRecord &record);
+    void to_controller_mapping(const bindb::IndexEntry &entry, 
+        ControllerMapping &mapping) const;
+
+    const std::string& get_filename() const { return filename; }
+
+  private:
+    std::string filename;
+    platform::MappedFile file;
+    const bindb::FileHeader *header = nullptr;
+    const bindb::IndexEntry *index = nullptr;
+    const bindb::BindingRecord *bindings = nullptr;
+    const char *strings = nullptr;
+
+    void init();
+
+    // Disable copy constructor and assign operator
+    BinaryMappingDb(const BinaryMappingDb&) = delete;
+    BinaryMappingDb& operator=(const BinaryMappingDb&) = delete;
+};
+
+} // namespace evdevjoy
+#endif
@@ -1,6 +1,8 @@
 #ifndef __BITEXT_H
 #define __BITEXT_H
 
+#include <climits>
+#include <cstddef>
 
 #ifdef __BITEXT_CPP
 #define EXTERN
@@ -11,4 +13,56 @@
 EXTERN bool is_little_endian();
 EXTERN int to_int16le(int value);
 
+// Fixed size bitmap in the layout used by the kernel (array of unsigned
+// long), e.g. filled by ioctl EVIOCGBIT
+template <std::size_t NBITS>
+struct Bitmap
+{
+    static const std::size_t BITS_PER_WORD = sizeof(unsigned long) * CHAR_BIT;
+    static const std::size_t WORDS = (NBITS + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+    unsigned long words[WORDS] = {};
+
+    bool test(std::size_t bit) const {
+        return (bit < NBITS) && ((words[bit / BITS_PER_WORD] >> (bit % BITS_PER_WORD)) & 1UL);
+    }
+
+    void set(std::size_t bit) {
+        if (bit < NBITS) {
+            words[bit / BITS_PER_WORD] |= 1UL << (bit % BITS_PER_WORD);
+        }
+    }
+
+    // True when any bit in [first, last) is set
+    bool any(std::size_t first, std::size_t last) const {
+        bool found = false;
+        for_each(first, last, [&found](std::size_t) { found = true; });
+        return found;
+    }
+
+    // Call fn(bit) for every set bit in [first, last) in increasing order.
+    // Zero words are skipped and set bits are found by count trailing zeros,
+    // the cost depends on the number of set bits, not on the range.
+    template <typename Fn>
+    void for_each(std::size_t first, std::size_t last, Fn fn) const {
+        if (last > NBITS) {
+            last = NBITS;
+        }
+        for (std::size_t i_word = first / BITS_PER_WORD; i_word * BITS_PER_WORD < last; i_word++) {
+            unsigned long word = words[i_word];
+            if (i_word == first / BITS_PER_WORD) {
+                word &= ~0UL << (first % BITS_PER_WORD);
+            }
+            while (word != 0) {
+                std::size_t bit = i_word * BITS_PER_WORD + __builtin_ctzl(word);
+                if (bit >= last) {
+                    return;
+                }
+                fn(bit);
+                word &= word - 1;
+            }
+        }
+    }
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "evdevjoy.h"
+#include "stringext.h"
+#include "namehash.h"
+
+namespace evdevjoy {
+
+// SDL names of the buttons and axes, compared case insensitive as in SDL
+static constexpr auto StringToControllerButton = make_name_map<ControllerButton>({
+    {"a", ControllerButton::BUTTON_A},
+    {"b", ControllerButton::BUTTON_B},
+    {"x", ControllerButton::BUTTON_X},
+    {"y", ControllerButton::BUTTON_Y},
+    {"back", ControllerButton::BUTTON_BACK},
+    {"guide", ControllerButton::BUTTON_GUIDE},
+    {"start", ControllerButton::BUTTON_START},
+    {"leftstick", ControllerButton::BUTTON_LEFTSTICK},
+    {"rightstick", ControllerButton::BUTTON_RIGHTSTICK},
+    {"leftshoulder", ControllerButton::BUTTON_LEFTSHOULDER},
+    {"rightshoulder", ControllerButton::BUTTON_RIGHTSHOULDER},
+    {"dpup", ControllerButton::BUTTON_DPAD_UP},
+    {"dpdown", ControllerButton::BUTTON_DPAD_DOWN},
+    {"dpleft", ControllerButton::BUTTON_DPAD_LEFT},
+    {"dpright", ControllerButton::BUTTON_DPAD_RIGHT},
+    {"misc1", ControllerButton::BUTTON_MISC1},
+    {"paddle1", ControllerButton::BUTTON_PADDLE1},
+    {"paddle2", ControllerButton::BUTTON_PADDLE2},
+    {"paddle3", ControllerButton::BUTTON_PADDLE3},
+    {"paddle4", ControllerButton::BUTTON_PADDLE4},
+    {"touchpad", ControllerButton::BUTTON_TOUCHPAD},
+    {"leftx", ControllerButton::AXIS_LEFTX},
+    {"lefty", ControllerButton::AXIS_LEFTY},
+    {"rightx", ControllerButton::AXIS_RIGHTX},
+    {"righty", ControllerButton::AXIS_RIGHTY},
+    {"lefttrigger", ControllerButton::AXIS_TRIGGERLEFT},
+    {"righttrigger", ControllerButton::AXIS_TRIGGERRIGHT},
+});
+
+std::string_view get_button_name(ControllerButton button)
+{
+    // Reverse of StringToControllerButton indexed by ControllerButton
+    static const auto names = [] {
+        std::array<std::string_view, static_cast<std::size_t>(ControllerButton::AXIS_MAX)> names{};
+        for (auto const &entry : StringToControllerButton) {
+            names[static_cast<std::size_t>(entry.value)] = entry.name;
+        }
+        return names;
+    }();
+    std::size_t index = static_cast<std::size_t>(button);
+    return (index < names.size()) ? names[index] : std::string_view();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ControllerMapping class
+//////////////////////////////////////////////////////////////////////////
+
+ControllerMapping::ControllerMapping(std::string_view mapping_str, priority_t priority)
+{
+    this->priority = priority;
+
+    std::size_t i_name = mapping_str.find(',');
+    std::size_t i_elements = (i_name == std::string_view::npos) ? 
+        std::string_view::npos : mapping_str.find(',', i_name + 1);
+
+    if (i_elements == std::string_view::npos) {
+        LOG(ERROR) << "ControllerMapping: wrong format of mapping string\n" \
+            << mapping_str;
+
+        throw std::runtime_error("Wrong format of mapping string");
+    }
+    if (!Guid::from_string(mapping_str.substr(0, i_name), guid)) {
+        LOG(ERROR) << "ControllerMapping: wrong guid of mapping string\n" \
+            << mapping_str;
+
+        throw std::runtime_error("Wrong guid of mapping string");
+    }
+    name = mapping_str.substr(i_name + 1, i_elements - i_name - 1);
+
+    // Walk the elements as slices of the mapping string, no copies
+    std::size_t i_start = i_elements + 1;
+    while (i_start < mapping_str.size()) {
+        std::size_t i_end = mapping_str.find(',', i_start);
+        if (i_end == std::string_view::npos) {
+            i_end = mapping_str.size();
+        }
+        if (i_end > i_start) {
+            parse_config_element(mapping_str.substr(i_start, i_end - i_start));
+        }
+        i_start = i_end + 1;
+    }
+}
+
+void ControllerMapping::parse_config_element(std::string_view item)
+{
+    std::size_t i_separator = item.find(':');
+    if (i_separator == std::string_view::npos) { 
+        LOG(ERROR) << "Wrong option value: " << item << std::endl;
+        return;
+    }
+    std::string_view key = item.substr(0, i_separator);
+    std::string_view value = item.substr(i_separator + 1);
+
+    if (key == "platform") {
+        platform = value;
+    } else if (key == "hint") {
+        hints[std::string(key)] = value;
+    } else {
+        if (value.length() > 0) {
+            add_button_binding(key, value);
+        }
+    }
+    
+}
+
+ControllerButton ControllerMapping::get_button_from_string(std::string_view name)
+{
+    std::size_t i_start = name.find_first_not_of("+-");
+    if (i_start == std::string_view::npos) {
+        return ControllerButton::INVALID;
+    }
+    std::size_t i_end = name.find_last_not_of("+-");
+    name = name.substr(i_start, i_end - i_start + 1);
+
+    const ControllerButton *button = StringToControllerButton.find(name);
+    if (button == nullptr) {
+        return ControllerButton::INVALID;
+    } else {
+        return *button;
+    }
+}
+
+void ControllerMapping::set_button_binding(ButtonBinding const &binding)
+{
+    button_binding.set(binding);
+}
+
+void ControllerMapping::add_button_binding(std::string_view button_name, std::string_view button_def)
+{
+    ButtonBinding binding = {};
+    ControllerButton button = get_button_from_string(button_name);
+
+    if (button == ControllerButton::INVALID) {
+        LOG(ERROR) << "add_button_binding:" << "invalid button_name: " << button_name;
+        return;
+    }
+
+    if ( (button > ControllerButton::BUTTON_MAX) && 
+        (button < ControllerButton::AXIS_MAX) ) 
+    {
+        binding.output_type = BindType::BINDTYPE_AXIS;
+        binding.output.axis = button;
+        if ((button == ControllerButton::AXIS_TRIGGERLEFT) || (button == ControllerButton::AXIS_TRIGGERRIGHT)) {
+            binding.output.axis_type = ControllerAxisType::HALF_AXIS_POSITIVE;
+        } if (button_name[0] == '+') {
+            binding.output.axis_type = ControllerAxisType::HALF_AXIS_POSITIVE;
+        } if (button_name[0] == '-') {
+            binding.output.axis_type = ControllerAxisType::HALF_AXIS_NEGATIVE;
+        } else {
+            binding.output.axis_type = ControllerAxisType::FULL_AXIS;
+        }
+    } else if (button < ControllerButton::BUTTON_MAX) {
+        binding.output_type = BindType::BINDTYPE_BUTTON;
+        binding.output.button = button;
+    } else {
+        LOG(ERROR) << "add_button_binding: unsupported button type ControllerButton(" << static_cast<int>(button) << ")";
+        return; // Unsupported button type
+    }
+
+    try {
+        int i_button_def = 0;
+        ControllerAxisType axis_input_type = ControllerAxisType::FULL_AXIS;
+        if (button_def.at(i_button_def) == '+') {
+            axis_input_type = ControllerAxisType::HALF_AXIS_POSITIVE;
+            ++i_button_def;
+        } else if (button_def.at(i_button_def) == '-') {
+            axis_input_type = ControllerAxisType::HALF_AXIS_NEGATIVE;
+            ++i_button_def;
+        }
+
+        if (button_def.at(i_button_def) == 'a') {
+            i_button_def++;
+            binding.input_type = BindType::BINDTYPE_AXIS;
+            binding.input.axis = string::to_int( button_def.substr(i_button_def++, 1) );
+            binding.input.axis_type = axis_input_type;
+            binding.input.invert_input = button_def.at(button_def.length()-1) == '~';
+        } else if (button_def.at(i_button_def) == 'b') {
+            i_button_def++;
+            binding.input_type = BindType::BINDTYPE_BUTTON;
+            std::size_t number_size = 0;
+            binding.input.button = string::to_int( button_def.substr(i_button_def), &number_size );
+            i_button_def += number_size;
+        } else if ( (button_def.at(i_button_def) == 'h') && (button_def.at(i_button_def+2) == '.') )  {
+            i_button_def++;
+            binding.input_type = BindType::BINDTYPE_HAT;
+            binding.input.hat = string::to_int( button_def.substr(i_button_def, 1) );
+            binding.input.hat_mask = string::to_int( button_def.substr(i_button_def+2, 1) );
+            i_button_def+=2;
+        } else {
+            LOG(ERROR) << "add_button_binding: unexpected joystick element \"" \
+                <<  button_def.at(i_button_def) << "\""; 
+            return; // Unexpected joystick element 
+        }
+
+    if (i_button_def < button_def.length()-1) {
+        LOG(WARNING) << "add_button_binding: processed " 
+            << i_button_def 
+            << " characters from button definition: " << button_def;
+    }
+    } catch (const std::out_of_range& oor) {
+        LOG(ERROR) << "add_button_binding: unexpected end of the button definition\n" \
+            << button_def; 
+        return; //Error
+    } catch (const std::invalid_argument& ia) {
+        LOG(ERROR) << "add_button_binding: invalid format of the button\n" \
+            << button_def; 
+        return; //Error
+    }
+    button_binding.insert(binding);
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,98 @@
+#include <algorithm>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "devicelayout.h"
+
+namespace evdevjoy {
+
+static const int MAX_HATS = 4;
+
+// Buttons of the xpad driver (Xbox gamepads), the most common layout
+static const int s_XpadButtons[] = {
+    BTN_SOUTH, BTN_EAST, BTN_NORTH, BTN_WEST, BTN_TL, BTN_TR,
+    BTN_SELECT, BTN_START, BTN_MODE, BTN_THUMBL, BTN_THUMBR
+};
+
+// Event code of the button with the index in the SDL order (increasing
+// codes), -1 when the index is out of range. Small gamepads get the xpad
+// buttons, then all gamepad buttons and BTN_TRIGGER_HAPPY<n> are used, the
+// joystick range when there are too many buttons.
+static int button_code(int index, int n_buttons)
+{
+    const int n_xpad = sizeof(s_XpadButtons) / sizeof(s_XpadButtons[0]);
+    const int n_gamepad = BTN_THUMBR - BTN_GAMEPAD + 1;
+    const int n_happy = BTN_TRIGGER_HAPPY40 - BTN_TRIGGER_HAPPY1 + 1;
+
+    if (n_buttons <= n_xpad) {
+        return s_XpadButtons[index];
+    }
+    if (n_buttons <= n_gamepad + n_happy) {
+        return (index < n_gamepad) ? BTN_GAMEPAD + index : BTN_TRIGGER_HAPPY1 + index - n_gamepad;
+    }
+    return (BTN_JOYSTICK + index < KEY_MAX) ? BTN_JOYSTICK + index : -1;
+}
+
+// Event code of the axis with the index, hats are skipped
+static int axis_code(int index)
+{
+    const int n_first = ABS_HAT0X;
+    int code = (index < n_first) ? index : ABS_HAT3Y + 1 + index - n_first;
+    return (code < ABS_MAX) ? code : -1;
+}
+
+DeviceDescriptor make_device_layout(const Guid &guid, const ControllerMapping &mapping)
+{
+    DeviceDescriptor descriptor;
+    if (!descriptor.set_guid(guid)) {
+        LOG(DEBUG) << "make_device_layout: guid is not made from evdev id: " << guid;
+    }
+    descriptor.name = mapping.name;
+    descriptor.devname = "/dev/input/by-guid/" + guid.to_string() + "-event-joystick";
+
+    int n_buttons = 0;
+    int n_hats = 0;
+    int n_axes = 0;
+    mapping.button_binding.for_each([&](const ButtonBinding &binding) {
+        switch (binding.input_type) {
+            case BindType::BINDTYPE_BUTTON:
+                n_buttons = std::max(n_buttons, binding.input.button + 1);
+                break;
+            case BindType::BINDTYPE_HAT:
+                n_hats = std::max(n_hats, binding.input.hat + 1);
+                break;
+            case BindType::BINDTYPE_AXIS:
+                n_axes = std::max(n_axes, binding.input.axis + 1);
+                break;
+            default:
+                break;
+        }
+    });
+
+    for (int i=0; i < n_buttons; i++) {
+        int code = button_code(i, n_buttons);
+        if (code < 0) {
+            LOG(WARNING) << "make_device_layout: too many buttons for " << guid;
+            break;
+        }
+        descriptor.key_bits.set(code);
+    }
+    for (int i=0; (i < n_hats) && (i < MAX_HATS); i++) {
+        descriptor.abs_bits.set(ABS_HAT0X + 2*i);
+        descriptor.abs_bits.set(ABS_HAT0Y + 2*i);
+    }
+    for (int i=0; i < n_axes; i++) {
+        int code = axis_code(i);
+        if (code < 0) {
+            LOG(WARNING) << "make_device_layout: too many axes for " << guid;
+            break;
+        }
+        descriptor.abs_bits.set(code);
+    }
+    return descriptor;
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,17 @@
+#ifndef __DEVICELAYOUT_H
+#define __DEVICELAYOUT_H
+
+#include "evdevjoy.h"
+
+namespace evdevjoy {
+
+// Synthetic device for the mapping (fleet mode, --fleet): the device has as
+// many buttons, hats and axes as the highest index used by the bindings, so
+// every binding of the mapping refers to an existing event. Up to 11 buttons
+// are the buttons of the xpad driver, more buttons are BTN_SOUTH ...
+// BTN_THUMBR and BTN_TRIGGER_HAPPY<n>, axes ABS_X ... in the order used by
+// SDL.
+DeviceDescriptor make_device_layout(const Guid &guid, const ControllerMapping &mapping);
+
+} // namespace evdevjoy
+#endif
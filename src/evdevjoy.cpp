@@ -5,7 +5,18 @@
 #include <string>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
+#include <cerrno>
 #include <filesystem>
+#include <algorithm>
+#include <system_error>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #ifndef ELPP_DEFAULT_LOGGER
 #   define ELPP_DEFAULT_LOGGER "evdevjoy"
@@ -16,7 +27,8 @@
 #include "evdevjoy.h"
 #include "stringext.h"
 #include "bitext.h"
-#include "joymapdb.h"
+#include "joymaptable.h"
+#include "bindb.h"
 
 
 using namespace platform;
@@ -28,37 +40,6 @@ namespace fs = std::filesystem;
 namespace evdevjoy {
 
 
-static const std::unordered_map<std::string, ControllerButton> StringToControllerButton = {
-    {"a", ControllerButton::BUTTON_A},
-    {"b", ControllerButton::BUTTON_B},
-    {"x", ControllerButton::BUTTON_X},
-    {"y", ControllerButton::BUTTON_Y},
-    {"back", ControllerButton::BUTTON_BACK},
-    {"guide", ControllerButton::BUTTON_GUIDE},
-    {"start", ControllerButton::BUTTON_START},
-    {"leftstick", ControllerButton::BUTTON_LEFTSTICK},
-    {"rightstick", ControllerButton::BUTTON_RIGHTSTICK},
-    {"leftshoulder", ControllerButton::BUTTON_LEFTSHOULDER},
-    {"rightshoulder", ControllerButton::BUTTON_RIGHTSHOULDER},
-    {"dpup", ControllerButton::BUTTON_DPAD_UP},
-    {"dpdown", ControllerButton::BUTTON_DPAD_DOWN},
-    {"dpleft", ControllerButton::BUTTON_DPAD_LEFT},
-    {"dpright", ControllerButton::BUTTON_DPAD_RIGHT},
-    {"misc1", ControllerButton::BUTTON_MISC1},
-    {"paddle1", ControllerButton::BUTTON_PADDLE1},
-    {"paddle2", ControllerButton::BUTTON_PADDLE2},
-    {"paddle3", ControllerButton::BUTTON_PADDLE3},
-    {"paddle4", ControllerButton::BUTTON_PADDLE4},
-    {"touchpad", ControllerButton::BUTTON_TOUCHPAD},
-    {"leftx", ControllerButton::AXIS_LEFTX},
-    {"lefty", ControllerButton::AXIS_LEFTY},
-    {"rightx", ControllerButton::AXIS_RIGHTX},
-    {"righty", ControllerButton::AXIS_RIGHTY},
-    {"lefttrigger", ControllerButton::AXIS_TRIGGERLEFT},
-    {"righttrigger", ControllerButton::AXIS_TRIGGERRIGHT},
-};
-
-
 std::string_view EventType::get_name() const
 {
     const char *event_name = libevdev_event_code_get_name(type, code);
@@ -73,197 +54,159 @@ std::string_view EventType::get_name() const
 // SDLJoyMapping class
 //////////////////////////////////////////////////////////////////////////
 
-ControllerMapping::ControllerMapping(std::string const &mapping_str, priority_t priority)
+SDLJoyMapping::SDLJoyMapping()
 {
-    std::vector<std::string> elements = string::split(mapping_str, ",");
-    
-    this->priority = priority;
-    if (elements.size() < 3) {
-        LOG(ERROR) << "ControllerMapping: wrong format of mapping string\n" \
-            << mapping_str;
-
-        throw std::runtime_error("Wrong format of mapping string");
-    }
-    guid = elements[0];
-    name = elements[1];
-    for(int i=2; i<elements.size(); i++) {
-        if (elements[i].length() > 0) {
-            parse_config_element(elements[i]);
-        }
-    }
 }
 
-void ControllerMapping::parse_config_element(const std::string &item)
+
+void SDLJoyMapping::add_sdl_mapping(ControllerMapping mapping)
 {
-    std::vector<std::string> element = string::split(item, ":", 1);
-    if (element.size() != 2) { 
-        LOG(ERROR) << "Wrong option value: " << item << std::endl;
+    if ((mapping.platform != "") && (mapping.platform != get_platform())) {
+        LOG(INFO) << "add_sdl_mapping: skip to add mapping for platform: " << mapping.platform;
         return;
     }
-    std::string key = element[0];
-    std::string value = element[1];
-
-    if (key == "platform") {
-        platform = value;
-    } else if (key == "hint") {
-        hints[key] = value;
-    } else {
-        if (value.length() > 0) {
-            add_button_binding(key, value);
+    
+    auto search = mapping_db.find(mapping.guid);
+    if (search != mapping_db.end()) {
+        if (mapping.priority >= search->second.priority) {
+            search->second = std::move(mapping);
         }
+    } else {
+        Guid guid = mapping.guid;
+        mapping_db.emplace(guid, std::move(mapping));
     }
-    
 }
 
-ControllerButton ControllerMapping::get_button_from_string(const std::string &name)
+void SDLJoyMapping::add_sdl_mapping(std::istream &iss, 
+        ControllerMapping::priority_t priority)
 {
-    auto it = StringToControllerButton.find(string::strip(name, "+-"));
-    if (it == StringToControllerButton.end()) {
-        return ControllerButton::INVALID;
-    } else {
-        return it->second;
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (!match_guid_filter(line)) {
+            continue;
+        }
+        try {
+            add_sdl_mapping(ControllerMapping(line, priority));
+        } catch (const std::runtime_error &e) {
+            LOG(WARNING) << "add_sdl_mapping: skip wrong mapping: " << line;
+        }
     }
 }
 
-void ControllerMapping::add_button_binding(const std::string &button_name, const std::string &button_def)
+void SDLJoyMapping::add_sdl_mapping(std::string_view text,
+        ControllerMapping::priority_t priority)
 {
-    ButtonBinding binding;
-    ControllerButton button = get_button_from_string(button_name);
-
-    if (button == ControllerButton::INVALID) {
-        LOG(ERROR) << "add_button_binding:" << "invalid button_name: " << button_name;
-        return;
-    }
+    std::size_t line_number = 0;
+
+    while (!text.empty()) {
+        std::size_t i_eol = text.find('\n');
+        std::string_view line = text.substr(0, i_eol);
+        text.remove_prefix((i_eol == std::string_view::npos) ? text.size() : i_eol + 1);
+        line_number++;
+
+        // Cheap checks on the first characters only, the line is parsed
+        // when it is not a comment and matches the guid filter
+        std::size_t i_start = line.find_first_not_of(" \t");
+        if ((i_start == std::string_view::npos) || (line[i_start] == '#') || 
+            (line[i_start] == '\r')) 
+        {
+            continue;
+        }
+        line.remove_prefix(i_start);
+        if (line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!match_guid_filter(line)) {
+            continue;
+        }
 
-    if ( (button > ControllerButton::BUTTON_MAX) && 
-        (button < ControllerButton::AXIS_MAX) ) 
-    {
-        binding.output_type = BindType::BINDTYPE_AXIS;
-        binding.output.axis = button;
-        if ((button == ControllerButton::AXIS_TRIGGERLEFT) || (button == ControllerButton::AXIS_TRIGGERRIGHT)) {
-            binding.output.axis_type = ControllerAxisType::HALF_AXIS_POSITIVE;
-        } if (button_name[0] == '+') {
-            binding.output.axis_type = ControllerAxisType::HALF_AXIS_POSITIVE;
-        } if (button_name[0] == '-') {
-            binding.output.axis_type = ControllerAxisType::HALF_AXIS_NEGATIVE;
-        } else {
-            binding.output.axis_type = ControllerAxisType::FULL_AXIS;
+        try {
+            add_sdl_mapping(ControllerMapping(line, priority));
+        } catch (const std::runtime_error &e) {
+            LOG(WARNING) << "add_sdl_mapping: skip wrong mapping on line " << line_number;
         }
-    } else if (button < ControllerButton::BUTTON_MAX) {
-        binding.output_type = BindType::BINDTYPE_BUTTON;
-        binding.output.button = button;
-    } else {
-        LOG(ERROR) << "add_button_binding: unsupported button type ControllerButton(" << static_cast<int>(button) << ")";
-        return; // Unsupported button type
     }
+}
 
+void SDLJoyMapping::add_mapping_file(std::string const &filename,
+        ControllerMapping::priority_t priority)
+{
+    platform::MappedFile file;
     try {
-        int i_button_def = 0;
-        ControllerAxisType axis_input_type = ControllerAxisType::FULL_AXIS;
-        if (button_def.at(i_button_def) == '+') {
-            axis_input_type = ControllerAxisType::HALF_AXIS_POSITIVE;
-            ++i_button_def;
-        } else if (button_def.at(i_button_def) == '-') {
-            axis_input_type = ControllerAxisType::HALF_AXIS_NEGATIVE;
-            ++i_button_def;
-        }
+        file = platform::MappedFile(filename);
+    } catch (const std::system_error &e) {
+        LOG(ERROR) << "add_mapping_file: " << e.what();
+        throw std::runtime_error(e.what());
+    }
 
-        if (button_def.at(i_button_def) == 'a') {
-            i_button_def++;
-            binding.input_type = BindType::BINDTYPE_AXIS;
-            binding.input.axis = std::stoi( button_def.substr(i_button_def++, 1) );
-            binding.input.axis_type = axis_input_type;
-            binding.input.invert_input = button_def.at(button_def.length()-1) == '~';
-        } else if (button_def.at(i_button_def) == 'b') {
-            i_button_def++;
-            binding.input_type = BindType::BINDTYPE_BUTTON;
-            std::size_t number_size = 0;
-            binding.input.button = std::stoi( button_def.substr(i_button_def), &number_size );
-            i_button_def += number_size;
-        } else if ( (button_def.at(i_button_def) == 'h') && (button_def.at(i_button_def+2) == '.') )  {
-            i_button_def++;
-            binding.input_type = BindType::BINDTYPE_HAT;
-            binding.input.hat = std::stoi( button_def.substr(i_button_def, 1) );
-            binding.input.hat_mask = std::stoi( button_def.substr(i_button_def+2, 1) );
-            i_button_def+=2;
-        } else {
-            LOG(ERROR) << "add_button_binding: unexpected joystick element \"" \
-                <<  button_def.at(i_button_def) << "\""; 
-            return; // Unexpected joystick element 
-        }
+    if (BinaryMappingDb::is_binary_db(file.view())) {
+        add_binary_mapping_db(filename, std::move(file));
+    } else {
+        LOG(INFO) << "add_mapping_file: load text mappings from: " << filename;
+        add_sdl_mapping(file.view(), priority);
+    }
+}
 
-    if (i_button_def < button_def.length()-1) {
-        LOG(WARNING) << "add_button_binding: processed " 
-            << i_button_def 
-            << " characters from button definition: " << button_def;
+void SDLJoyMapping::add_user_mappings()
+{
+    const char *env_file_value = std::getenv("SDL_GAMECONTROLLERCONFIG_FILE");
+    if ((env_file_value != nullptr) && (*env_file_value != '\0')) {
+        try {
+            add_mapping_file(env_file_value, ControllerMapping::PRIORITY_USER);
+        } catch (const std::runtime_error &e) {
+            LOG(WARNING) << "Cannot load SDL_GAMECONTROLLERCONFIG_FILE: " << env_file_value;
+        }
     }
-    } catch (const std::out_of_range& oor) {
-        LOG(ERROR) << "add_button_binding: unexpected end of the button definition\n" \
-            << button_def; 
-        return; //Error
-    } catch (const std::invalid_argument& ia) {
-        LOG(ERROR) << "add_button_binding: invalid format of the button\n" \
-            << button_def; 
-        return; //Error
+
+    const char *env_var_value = std::getenv("SDL_GAMECONTROLLERCONFIG");
+    if (env_var_value != nullptr) {
+        add_sdl_mapping(std::string_view(env_var_value), ControllerMapping::PRIORITY_USER);
     }
-    button_binding.emplace(button, binding);
 }
 
-//////////////////////////////////////////////////////////////////////////
-// SDLJoyMapping class
-//////////////////////////////////////////////////////////////////////////
-
-SDLJoyMapping::SDLJoyMapping()
+void SDLJoyMapping::set_guid_filter(std::vector<Guid> const &guids)
 {
+    guid_filter = guids;
+    std::sort(guid_filter.begin(), guid_filter.end());
+    guid_filter.erase(std::unique(guid_filter.begin(), guid_filter.end()),
+        guid_filter.end());
 }
 
-
-void SDLJoyMapping::add_sdl_mapping(ControllerMapping const &mapping)
+bool SDLJoyMapping::match_guid_filter(std::string_view mapping_str) const
 {
-    if ((mapping.platform != "") && (mapping.platform != get_platform())) {
-        LOG(INFO) << "add_sdl_mapping: skip to add mapping for platform: " << mapping.platform;
-        return;
+    if (guid_filter.empty()) {
+        return true;
     }
-    
-    auto search = mapping_db.find(mapping.guid);
-    if (search != mapping_db.end()) {
-        if (mapping.priority >= search->second.priority) {
-            mapping_db[mapping.guid] = mapping;
-        }
-    } else {
-        mapping_db[mapping.guid] = mapping;
+
+    Guid guid;
+    if ((mapping_str.size() > Guid::STRING_LENGTH) && (mapping_str[Guid::STRING_LENGTH] != ',')) {
+        return false;
     }
+    if (!Guid::from_string(mapping_str.substr(0, Guid::STRING_LENGTH), guid)) {
+        return false;
+    }
+    return std::binary_search(guid_filter.begin(), guid_filter.end(), guid);
 }
 
-void SDLJoyMapping::add_sdl_mapping(std::istream &iss, 
-        ControllerMapping::priority_t priority)
+void SDLJoyMapping::add_internal_mappings()
 {
-    std::string line;
-    while (std::getline(iss, line)) {
-        ControllerMapping mapping(line, priority);
-        add_sdl_mapping(mapping);
-    }
+    // The internal database is compiled into joymapdb_table.h at build time,
+    // entries are only looked up (and converted) in get_mapping()
+    use_internal_db = true;
 }
 
-void SDLJoyMapping::add_user_mappings()
+void SDLJoyMapping::add_binary_mapping_db(std::string const &filename)
 {
-    const char *env_var_value = std::getenv("SDL_GAMECONTROLLERCONFIG");
-    if (env_var_value != nullptr) {
-        std::istringstream iss(env_var_value);
-        add_sdl_mapping(iss, ControllerMapping::PRIORITY_USER);
-    }
+    binary_dbs.push_back(std::make_unique<BinaryMappingDb>(filename));
 }
 
-void SDLJoyMapping::add_internal_mappings()
+void SDLJoyMapping::add_binary_mapping_db(std::string const &filename, 
+        platform::MappedFile &&file)
 {
-    // Search internal mapping database
-    for (int i=0; s_ControllerMappings[i] != NULL; i++) {
-        ControllerMapping mapping(s_ControllerMappings[i], ControllerMapping::PRIORITY_DEFAULT);
-        add_sdl_mapping(mapping);
-    }
+    binary_dbs.push_back(std::make_unique<BinaryMappingDb>(filename, std::move(file)));
 }
 
-ControllerMapping* SDLJoyMapping::get_mapping(std::string const &guid)
+ControllerMapping* SDLJoyMapping::get_mapping(Guid const &guid)
 {
     auto it = mapping_db.find(guid);
     if ( it != mapping_db.end() ) {
@@ -271,15 +214,101 @@ ControllerMapping* SDLJoyMapping::get_mapping(std::string const &guid)
             << ", " << it->second.name;
         return &it->second;
     }
+
+    for (auto db = binary_dbs.rbegin(); db != binary_dbs.rend(); ++db) {
+        const bindb::IndexEntry *entry = (*db)->find(guid);
+        if (entry != nullptr) {
+            LOG(INFO) << "Found joystick mapping in " << (*db)->get_filename()
+                << " for guid: " << guid << ", " << (*db)->get_name(*entry);
+            ControllerMapping &mapping = mapping_db[guid];
+            (*db)->to_controller_mapping(*entry, mapping);
+            return &mapping;
+        }
+    }
+
+    if (use_internal_db) {
+        const CompiledMapping *compiled = find_internal_mapping(guid);
+        if (compiled != nullptr) {
+            LOG(INFO) << "Found joystick mapping in internal database for guid: " << guid
+                << ", " << compiled->name;
+            ControllerMapping &mapping = mapping_db[guid];
+            mapping.guid = compiled->guid;
+            mapping.name = compiled->name;
+            mapping.priority = ControllerMapping::PRIORITY_DEFAULT;
+
+            const ButtonBinding *bindings = internal_mapping_bindings(*compiled);
+            for (int i=0; i < compiled->binding_count; i++) {
+                mapping.set_button_binding(bindings[i]);
+            }
+            return &mapping;
+        }
+    }
     return nullptr;
 }
 
 
+std::vector<Guid> SDLJoyMapping::get_guids() const
+{
+    std::vector<Guid> guids;
+    guids.reserve(mapping_db.size());
+    for (auto const &item : mapping_db) {
+        guids.push_back(item.first);
+    }
+    for (auto const &db : binary_dbs) {
+        for (std::size_t i=0; i < db->size(); i++) {
+            guids.push_back(db->get_guid(i));
+        }
+    }
+    if (use_internal_db) {
+        for (std::size_t i=0; i < internal_mapping_count(); i++) {
+            guids.push_back(internal_mapping(i).guid);
+        }
+    }
+
+    std::sort(guids.begin(), guids.end());
+    guids.erase(std::unique(guids.begin(), guids.end()), guids.end());
+    return guids;
+}
+
 SDLJoyMapping::~SDLJoyMapping()
 {
 
 }
 
+//////////////////////////////////////////////////////////////////////////
+// DeviceDescriptor struct
+//////////////////////////////////////////////////////////////////////////
+void DeviceDescriptor::get_guid(joy_guid_t &guid) const
+{
+    uint16_t *guid16 = reinterpret_cast<uint16_t*>(&guid);
+    guid16[0] = to_int16le(bustype);
+    guid16[1] = 0;
+    guid16[2] = to_int16le(vendor);
+    guid16[3] = 0;
+    guid16[4] = to_int16le(product);
+    guid16[5] = 0;
+    guid16[6] = to_int16le(version);
+    guid16[7] = 0;
+}
+
+Guid DeviceDescriptor::get_guid() const
+{
+    joy_guid_t guid_bytes;
+    get_guid(guid_bytes);
+    return Guid::from_bytes(guid_bytes);
+}
+
+bool DeviceDescriptor::set_guid(const Guid &guid)
+{
+    uint8_t bytes[16];
+    guid.to_bytes(bytes);
+    bustype = bytes[0] | (bytes[1] << 8);
+    vendor = bytes[4] | (bytes[5] << 8);
+    product = bytes[8] | (bytes[9] << 8);
+    version = bytes[12] | (bytes[13] << 8);
+    return get_guid() == guid;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // EvdevJoystick class
 //////////////////////////////////////////////////////////////////////////
@@ -301,89 +330,323 @@ std::vector<std::string> EvdevJoystick::get_event_devices()
     return ev_devices;
 }
 
-EvdevJoystick::EvdevJoystick(std::string const &devname)
+// Threads of open_devices(). Blocking open() or ioctl() cannot be
+// cancelled, the late probe keeps its thread busy and its device is released
+// by the thread. At most MAX_THREADS probes run in time, the late probes do
+// not count, so the devices queued behind the hung ones still get their
+// thread and the full timeout. A device is not probed again while its
+// previous probe runs, so the hung devices do not add threads or descriptors
+// (--daemon). The threads are joined before the static objects used by the
+// probes (logging) are destroyed.
+class ProbePool
 {
-    int fd = open(devname.c_str(), O_RDONLY|O_NONBLOCK);
-    int rc = libevdev_new_from_fd(fd, &evdev);
+  public:
+    typedef std::unique_ptr<EvdevJoystick> t_uptr_joystick;
+    static const std::size_t MAX_THREADS = 8;
+
+    struct Probe
+    {
+        std::string devname;
+        bool started = false;
+        bool done = false;
+        bool late = false;              // no result in the timeout
+        std::chrono::steady_clock::time_point start;
+        t_uptr_joystick device;         // result when done, or the error
+        std::exception_ptr error;
+    };
+    typedef std::shared_ptr<Probe> t_sptr_probe;
+
+    // Created by the first probe, after the static objects of logging
+    static ProbePool& instance() {
+        static ProbePool pool;
+        return pool;
+    }
+    ~ProbePool();
+
+    // nullptr when the previous probe of the device still runs
+    t_sptr_probe submit(const std::string &devname);
+    // Wait until every probe is done or late, the timeout of the probe
+    // starts with the probe (zero timeout waits without limit)
+    void wait(std::vector<t_sptr_probe> const &probes, std::chrono::milliseconds timeout);
+    // Cancel the queued probes and wait for the running ones, false on
+    // timeout
+    bool finish(std::chrono::milliseconds timeout);
+
+  private:
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::condition_variable task_changed;   // probe started or done
+    std::deque<t_sptr_probe> tasks;
+    std::set<std::string> running;
+    std::vector<std::thread> threads;
+    std::size_t idle = 0;
+    std::size_t late = 0;                   // threads of the late probes
+    bool stopping = false;
+
+    ProbePool() = default;
+    void add_thread();
+    void run();
+};
+
+ProbePool::~ProbePool()
+{
+    if (!finish(std::chrono::milliseconds(0))) {
+        // Reached only by exit() without EvdevJoystick::finish_probes(), the
+        // status of the run is not known here
+        el::Loggers::flushAll();
+        std::cout.flush();
+        std::_Exit(EXIT_FAILURE);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_ready.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+ProbePool::t_sptr_probe ProbePool::submit(const std::string &devname)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running.count(devname)) {
+        return nullptr;
+    }
+    t_sptr_probe probe = std::make_shared<Probe>();
+    probe->devname = devname;
+    tasks.push_back(probe);
+    add_thread();
+    task_ready.notify_one();
+    return probe;
+}
+
+// Called with the locked mutex
+void ProbePool::add_thread()
+{
+    if ((tasks.size() > idle) && (threads.size() - late < MAX_THREADS)) {
+        threads.emplace_back(&ProbePool::run, this);
+    }
+}
+
+void ProbePool::wait(std::vector<t_sptr_probe> const &probes, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        auto next = std::chrono::steady_clock::time_point::max();
+        bool waiting = false;
+        for (auto const &probe : probes) {
+            if (!probe || probe->done || probe->late) {
+                continue;
+            }
+            if (!probe->started || (timeout.count() == 0)) {
+                waiting = true;
+            } else if (probe->start + timeout <= now) {
+                // Its thread is lost for the queued probes
+                probe->late = true;
+                late++;
+                add_thread();
+                task_ready.notify_one();
+            } else {
+                waiting = true;
+                next = std::min(next, probe->start + timeout);
+            }
+        }
+        if (!waiting) {
+            return;
+        }
+        if (next == std::chrono::steady_clock::time_point::max()) {
+            task_changed.wait(lock);
+        } else {
+            task_changed.wait_until(lock, next);
+        }
+    }
+}
+
+bool ProbePool::finish(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks.clear();
+    return task_changed.wait_for(lock, timeout, [this]() { return running.empty(); });
+}
+
+void ProbePool::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        idle++;
+        task_ready.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        idle--;
+        if (tasks.empty()) {
+            return;
+        }
+        t_sptr_probe probe = tasks.front();
+        tasks.pop_front();
+        probe->started = true;
+        probe->start = std::chrono::steady_clock::now();
+        running.insert(probe->devname);
+        task_changed.notify_all();
+        lock.unlock();
+
+        t_uptr_joystick device;
+        std::exception_ptr error;
+        try {
+            device = std::make_unique<EvdevJoystick>(probe->devname);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (probe->late) {
+            late--;
+        }
+        probe->device = std::move(device);
+        probe->error = error;
+        probe->done = true;
+        running.erase(probe->devname);
+        task_changed.notify_all();
+    }
+}
+
+std::vector<std::unique_ptr<EvdevJoystick>> EvdevJoystick::open_devices(
+        std::vector<std::string> const &devnames, std::chrono::milliseconds timeout)
+{
+    typedef std::unique_ptr<EvdevJoystick> t_uptr_joystick;
+    std::vector<ProbePool::t_sptr_probe> probes;
+
+    ProbePool &pool = ProbePool::instance();
+    probes.reserve(devnames.size());
+    for (auto const &devname : devnames) {
+        probes.push_back(pool.submit(devname));
+    }
+    pool.wait(probes, timeout);
+
+    // The probes which are done or late are not changed by the pool
+    std::vector<t_uptr_joystick> devices(devnames.size());
+    for (std::size_t i=0; i < probes.size(); i++) {
+        if (!probes[i]) {
+            LOG(WARNING) << "Skip device, its previous probe still runs: " << devnames[i];
+        } else if (probes[i]->late) {
+            LOG(WARNING) << "Skip device, no response in " << timeout.count() 
+                << " ms: " << devnames[i];
+        } else if (probes[i]->error) {
+            try {
+                std::rethrow_exception(probes[i]->error);
+            } catch (const std::exception &e) {
+                LOG(WARNING) << "Skip device " << devnames[i] << ": " << e.what();
+            }
+        } else {
+            devices[i] = std::move(probes[i]->device);
+        }
+    }
+    return devices;
+}
 
+void EvdevJoystick::finish_probes(std::chrono::milliseconds timeout, int status)
+{
+    if (!ProbePool::instance().finish(timeout)) {
+        // The hung probe does not change the exit status
+        LOG(WARNING) << "Device probe still runs, exit without cleanup";
+        el::Loggers::flushAll();
+        std::cout.flush();
+        std::_Exit(status);
+    }
+}
+
+EvdevJoystick::EvdevJoystick(std::string const &devname)
+{
     LOG(INFO) << "EvdevJoystick: open device: " << devname;
+    int fd = open(devname.c_str(), O_RDONLY|O_NONBLOCK|O_CLOEXEC);
+    if (fd < 0) {
+        int err = errno;
+        LOG(ERROR) << "Failed to open device (" << devname << ")\n" \
+            << "  " << std::strerror(err);
+        throw std::runtime_error("Failed to open device: " + std::string(std::strerror(err)));
+    }
+
+    int rc = libevdev_new_from_fd(fd, &evdev);
     if (rc < 0) {
+        close(fd);
         LOG(ERROR) << "Failed to init libevdev (" << devname << ")\n" \
             << "  " << std::strerror(-rc);
         throw std::runtime_error("Failed to init libevdev");
     }
-    this->devname = devname;
-    get_button_settings();
-    get_hat_settings();
-    get_axes_settings();
+    descriptor.devname = devname;
+    const char *name = libevdev_get_name(evdev);
+    descriptor.name = (name != nullptr) ? name : "";
+    descriptor.bustype = libevdev_get_id_bustype(evdev);
+    descriptor.vendor = libevdev_get_id_vendor(evdev);
+    descriptor.product = libevdev_get_id_product(evdev);
+    descriptor.version = libevdev_get_id_version(evdev);
+    get_capabilities();
+    init_settings();
 }
 
-void EvdevJoystick::get_guid(joy_guid_t &guid)
+EvdevJoystick::EvdevJoystick(DeviceDescriptor const &descriptor)
+    : descriptor(descriptor)
 {
-    uint16_t *guid16 = reinterpret_cast<uint16_t*>(&guid);
-    guid16[0] = to_int16le(libevdev_get_id_bustype(evdev));
-    guid16[1] = 0;
-    guid16[2] = to_int16le(libevdev_get_id_vendor(evdev));
-    guid16[3] = 0;
-    guid16[4] = to_int16le(libevdev_get_id_product(evdev));
-    guid16[5] = 0;
-    guid16[6] = to_int16le(libevdev_get_id_version(evdev));
-    guid16[7] = 0;
+    LOG(INFO) << "EvdevJoystick: device from descriptor: " << descriptor.devname;
+    init_settings();
 }
 
-std::string_view EvdevJoystick::get_name()
+void EvdevJoystick::init_settings()
 {
-    return libevdev_get_name(evdev);
+    devname = descriptor.devname;
+    guid = descriptor.get_guid();
+    get_button_settings();
+    get_hat_settings();
+    get_axes_settings();
 }
 
-std::string EvdevJoystick::get_guid()
+void EvdevJoystick::get_capabilities()
 {
-    static const char hex2ascii[] = "0123456789abcdef";
+    Bitmap<KEY_CNT> &key_bits = descriptor.key_bits;
+    Bitmap<ABS_CNT> &abs_bits = descriptor.abs_bits;
+    int fd = libevdev_get_fd(evdev);
 
-    joy_guid_t guid;
-    get_guid(guid);
-    std::string result;
-    
-    result.reserve(32);
-    for (int i=0; i<sizeof(guid); i++) {
-        result += hex2ascii[(guid[i] >> 4)];
-        result += hex2ascii[(guid[i] & 0x0f )];
+    if ((ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits.words)), key_bits.words) >= 0) &&
+        (ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits.words)), abs_bits.words) >= 0)) 
+    {
+        return;
+    }
+
+    // Not an event device (e.g. device created by libevdev), ask libevdev
+    LOG(DEBUG) << "get_capabilities: EVIOCGBIT failed, " << std::strerror(errno);
+    key_bits = Bitmap<KEY_CNT>();
+    abs_bits = Bitmap<ABS_CNT>();
+    for (unsigned int code=0; code < KEY_CNT; code++) {
+        if (libevdev_has_event_code(evdev, EV_KEY, code)) {
+            key_bits.set(code);
+        }
+    }
+    for (unsigned int code=0; code < ABS_CNT; code++) {
+        if (libevdev_has_event_code(evdev, EV_ABS, code)) {
+            abs_bits.set(code);
+        }
     }
-    return result;
 }
 
 void EvdevJoystick::get_button_settings()
 {
-    int event_code;
+    auto add_button = [this](std::size_t event_code) {
+        buttons.push_back(EventType(EV_KEY, event_code));
+        LOG(DEBUG) << "get_button_settings: button: " \
+            << buttons.size()-1 << ", " << buttons.back().get_name();
+    };
 
+    // Same order as SDL, joystick and gamepad buttons first
     buttons.clear();
-    for (event_code=BTN_JOYSTICK; event_code < KEY_MAX; ++event_code) {
-        if (libevdev_has_event_code(evdev, EV_KEY, event_code)) {
-            buttons.push_back(EventType(EV_KEY, event_code));
-            LOG(DEBUG) << "get_button_settings: button: " \
-                << buttons.size()-1 << ", " << buttons.back().get_name();
-        }
-    }
-    for (event_code=BTN_MISC; event_code < BTN_JOYSTICK; ++event_code) {
-        if (libevdev_has_event_code(evdev, EV_KEY, event_code)) {
-            buttons.push_back(EventType(EV_KEY, event_code));
-            LOG(DEBUG) << "get_button_settings: button:" \
-                << buttons.size()-1 << ", " << buttons.back().get_name();
-        }
-    }
+    descriptor.key_bits.for_each(BTN_JOYSTICK, KEY_MAX, add_button);
+    descriptor.key_bits.for_each(BTN_MISC, BTN_JOYSTICK, add_button);
 }
 
 void EvdevJoystick::get_hat_settings()
 {
-    int event_code;
-
     hats.clear();
-    for (event_code=ABS_HAT0X; event_code < ABS_HAT3Y; event_code += 2) {
-        if (libevdev_has_event_code(evdev, EV_ABS, event_code) || 
-            libevdev_has_event_code(evdev, EV_ABS, event_code+1)) 
-        {
-            const struct input_absinfo *absinfo = libevdev_get_abs_info(evdev, event_code);
-            if (absinfo == nullptr) continue;
+    for (int event_code=ABS_HAT0X; event_code < ABS_HAT3Y; event_code += 2) {
+        // SDL uses only hats with the X axis
+        if (descriptor.abs_bits.test(event_code)) {
             hats.push_back( HatEventType{
                                 EventType(EV_ABS, event_code),
                                 EventType(EV_ABS, event_code+1)
@@ -397,28 +660,39 @@ void EvdevJoystick::get_hat_settings()
 
 void EvdevJoystick::get_axes_settings()
 {
-    int event_code;
+    auto add_axis = [this](std::size_t event_code) {
+        axes.push_back(EventType(EV_ABS, event_code));
+        LOG(DEBUG) << "get_axes_settings: axes: " << axes.size()-1 \
+            << ", " << axes.back().get_name();
+    };
 
+    // Hats are skipped
     axes.clear();
-    for (event_code=0; event_code < ABS_MAX; event_code++) {
-        // Skip hats
-        if (event_code == ABS_HAT0X) {
-            event_code = ABS_HAT3Y;
-            continue;
-        }
-         if (libevdev_has_event_code(evdev, EV_ABS, event_code)) {
+    descriptor.abs_bits.for_each(0, ABS_HAT0X, add_axis);
+    descriptor.abs_bits.for_each(ABS_HAT3Y + 1, ABS_MAX, add_axis);
+
+    // Ranges of the axes and hats, transforms of RemapTable are built from them
+    if (evdev != nullptr) {
+        descriptor.abs_bits.for_each(0, ABS_CNT, [this](std::size_t event_code) {
             const struct input_absinfo *absinfo = libevdev_get_abs_info(evdev, event_code);
-            axes.push_back(EventType(EV_ABS, event_code));
-            LOG(DEBUG) << "get_axes_settings: axes: " << axes.size()-1 \
-                << ", " << axes.back().get_name();
-         }
+            if (absinfo != nullptr) {
+                abs_info[event_code] = *absinfo;
+            }
+        });
     }
+}
 
+const struct input_absinfo* EvdevJoystick::get_abs_info(unsigned int code) const
+{
+    if ((evdev == nullptr) || (code >= ABS_CNT) || !descriptor.abs_bits.test(code)) {
+        return nullptr;
+    }
+    return &abs_info[code];
 }
 
 void EvdevJoystick::set_mapping(ControllerMapping const &mapping)
 {
-    this->mapping = mapping;
+    button_binding = mapping.button_binding;
 }
 
 bool EvdevJoystick::set_mapping(SDLJoyMapping &joy_mapping)
@@ -426,42 +700,42 @@ bool EvdevJoystick::set_mapping(SDLJoyMapping &joy_mapping)
     ControllerMapping *pmapping=nullptr;
 
     if  (pmapping=joy_mapping.get_mapping(get_guid())) {
-        mapping = *pmapping;
+        button_binding = pmapping->button_binding;
         return true;
     }
     return false;
 }
 
-EventButtonBinding EvdevJoystick::get_event_binding(ControllerButton button)
+EventButtonBinding EvdevJoystick::get_event_binding(ControllerButton button) const
 {
     EventButtonBinding event_binding;
-    auto const it=mapping.button_binding.find(button);
+    const ButtonBinding *binding = button_binding.find(button);
 
-    if (it != mapping.button_binding.end()) {
-        event_binding.bind = &it->second;
+    if (binding != nullptr) {
+        event_binding.bind = binding;
         try {
-            if (it->second.input_type == BindType::BINDTYPE_BUTTON) {
-                event_binding.event = &buttons.at(it->second.input.button);
+            if (binding->input_type == BindType::BINDTYPE_BUTTON) {
+                event_binding.event = &buttons.at(binding->input.button);
             } else 
-            if (it->second.input_type == BindType::BINDTYPE_HAT) {
-                int hat_mask = it->second.input.hat_mask;
+            if (binding->input_type == BindType::BINDTYPE_HAT) {
+                int hat_mask = binding->input.hat_mask;
                 if ( hat_mask & (HatMask::UP | HatMask::DOWN) ) {
-                    event_binding.event = &hats.at(it->second.input.hat).y;
+                    event_binding.event = &hats.at(binding->input.hat).y;
                 } else
                 if ( hat_mask & (HatMask::LEFT | HatMask::RIGHT) ) {
-                    event_binding.event = &hats.at(it->second.input.hat).x;
+                    event_binding.event = &hats.at(binding->input.hat).x;
                 } else {
-                    LOG(ERROR) << "get_event_binding: Wrong value of HAT:" << it->second.input.hat
+                    LOG(ERROR) << "get_event_binding: Wrong value of HAT:" << binding->input.hat
                         << " mask: " << hat_mask;
                     event_binding.bind = nullptr;
                     event_binding.event = nullptr;
                 }
                 
             } else 
-            if (it->second.input_type == BindType::BINDTYPE_AXIS) {
-                event_binding.event = &axes.at(it->second.input.axis);
+            if (binding->input_type == BindType::BINDTYPE_AXIS) {
+                event_binding.event = &axes.at(binding->input.axis);
             } else {
-                LOG(ERROR) << "Unexpected BindType value: " << static_cast<int>(it->second.input_type);
+                LOG(ERROR) << "Unexpected BindType value: " << static_cast<int>(binding->input_type);
             }
         } catch (std::out_of_range const& exc) {
             event_binding.bind = nullptr;
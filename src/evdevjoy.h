@@ -1,18 +1,26 @@
 #ifndef __EVDEVJOY_H
 #define __EVDEVJOY_H
 
+#include <array>
 #include <string>
 #include <string_view>
 #include <cstdint>
 #include <vector>
+#include <memory>
+#include <chrono>
 #include <map>
 #include <unordered_map>
+#include <type_traits>
 #include <libevdev/libevdev.h>
+#include "mmapfile.h"
+#include "guid.h"
+#include "bitext.h"
 
 namespace evdevjoy {
 
 class ControllerMapping;
 class EvdevJoystick;
+class BinaryMappingDb;
 
 
 enum class ControllerButton
@@ -49,6 +57,9 @@ enum class ControllerButton
     AXIS_MAX
 };
 
+// SDL name of the button or axis ("a", "leftx"), empty for invalid value
+std::string_view get_button_name(ControllerButton button);
+
 namespace HatMask {
     const int UP = 0x1;
     const int RIGHT = 0x2;
@@ -71,35 +82,94 @@ enum class ControllerAxisType
   HALF_AXIS_NEGATIVE
 };
 
+// Plain aggregate (no unions) so that the binding tables of the internal
+// database can be generated as constexpr arrays, see joymaptable.h
 struct ButtonBinding
 {
     BindType input_type;
-    union 
+    struct
     {
         int button;
-        struct {
-            int axis;
-            ControllerAxisType axis_type;
-            bool invert_input;
-        };
-
-        struct {
-            int hat;
-            int hat_mask;
-        };
+        int axis;
+        ControllerAxisType axis_type;
+        bool invert_input;
+        int hat;
+        int hat_mask;
     } input;
 
     BindType output_type;     // BINDTYPE_AXIS or BINDTYPE_BUTTON
-    union
+    struct
     {
         ControllerButton button;
-        struct {
-            ControllerButton axis;
-            ControllerAxisType axis_type;
-        };
+        ControllerButton axis;
+        ControllerAxisType axis_type;
     } output;
 };
 
+// Bindings of one controller indexed by ControllerButton, presence of the
+// binding is stored in the bitmask. Trivially copyable, O(1) lookup.
+class ButtonBindingTable
+{
+  public:
+    static const std::size_t SIZE = static_cast<std::size_t>(ControllerButton::AXIS_MAX);
+
+    // Key of the binding: output axis or output button
+    static ControllerButton get_key(ButtonBinding const &binding) {
+        return (binding.output_type == BindType::BINDTYPE_AXIS) ?
+            binding.output.axis : binding.output.button;
+    }
+
+    bool contains(ControllerButton button) const {
+        return valid(button) && (present & bit(button));
+    }
+
+    const ButtonBinding* find(ControllerButton button) const {
+        return contains(button) ? &bindings[static_cast<std::size_t>(button)] : nullptr;
+    }
+
+    // Add or replace the binding, returns false for invalid key
+    bool set(ButtonBinding const &binding) {
+        ControllerButton button = get_key(binding);
+        if (!valid(button)) {
+            return false;
+        }
+        bindings[static_cast<std::size_t>(button)] = binding;
+        present |= bit(button);
+        return true;
+    }
+
+    // Add the binding only if the key is not used yet
+    bool insert(ButtonBinding const &binding) {
+        return !contains(get_key(binding)) && set(binding);
+    }
+
+    void clear() { present = 0; }
+    bool empty() const { return present == 0; }
+    std::size_t size() const { return static_cast<std::size_t>(__builtin_popcount(present)); }
+
+    // Call func(ButtonBinding const&) for all bindings in order of ControllerButton
+    template <typename Func>
+    void for_each(Func func) const {
+        for (uint32_t mask = present; mask != 0; mask &= mask - 1) {
+            func(bindings[__builtin_ctz(mask)]);
+        }
+    }
+
+  private:
+    static bool valid(ControllerButton button) {
+        return (button > ControllerButton::INVALID) && (button < ControllerButton::AXIS_MAX);
+    }
+    static uint32_t bit(ControllerButton button) {
+        return uint32_t(1) << static_cast<int>(button);
+    }
+
+    uint32_t present = 0;
+    ButtonBinding bindings[SIZE];
+};
+static_assert(ButtonBindingTable::SIZE <= 32, "ButtonBindingTable bitmask is too small");
+static_assert(std::is_trivially_copyable<ButtonBindingTable>::value,
+    "ButtonBindingTable must be trivially copyable");
+
 //////////////////////////////////////////////////////////////////////////
 // ControllerMapping
 //////////////////////////////////////////////////////////////////////////
@@ -113,21 +183,23 @@ class ControllerMapping {
     PRIORITY_USER
   } priority_t;
 
-    std::string guid;
+    Guid guid;
     std::string name;
     std::string platform;
     priority_t priority;
     std::map<std::string, std::string> hints;
-    std::map<ControllerButton, ButtonBinding> button_binding;
+    ButtonBindingTable button_binding;
     
     ControllerMapping() : priority(PRIORITY_DEFAULT) {}
-    ControllerMapping(std::string const &mapping_str, priority_t priority = PRIORITY_DEFAULT);
-    ControllerButton get_button_from_string(const std::string &name);
+    ControllerMapping(std::string_view mapping_str, priority_t priority = PRIORITY_DEFAULT);
+    ControllerButton get_button_from_string(std::string_view name);
+    // Add already parsed binding (e.g. from compiled database)
+    void set_button_binding(ButtonBinding const &binding);
 
   protected:
-    void parse_config_element(const std::string &item);
-    void add_button_binding(const std::string &button_name, 
-        const std::string &button_def);
+    void parse_config_element(std::string_view item);
+    void add_button_binding(std::string_view button_name, 
+        std::string_view button_def);
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -139,24 +211,51 @@ class SDLJoyMapping {
 
     SDLJoyMapping();
     // Add mapping only of the corresponding platform
-    void add_sdl_mapping(ControllerMapping const &mapping);
+    void add_sdl_mapping(ControllerMapping mapping);
     void add_sdl_mapping(std::istream &iss, 
         ControllerMapping::priority_t priority = ControllerMapping::PRIORITY_API);
+    // Add mappings from the text in gamecontrollerdb.txt format, one mapping
+    // per line. Blank lines and comments (#) are skipped.
+    void add_sdl_mapping(std::string_view text,
+        ControllerMapping::priority_t priority = ControllerMapping::PRIORITY_API);
+
+    // Add mapping file, binary database (see bindb.h) or text file in
+    // gamecontrollerdb.txt format. Throws std::runtime_error on error.
+    void add_mapping_file(std::string const &filename,
+        ControllerMapping::priority_t priority = ControllerMapping::PRIORITY_API);
+
+    // Lazy mode: text mappings are fully parsed only when the guid (first
+    // 32 characters of the line) is in the filter. Empty filter disables
+    // the lazy mode and all mappings are parsed.
+    void set_guid_filter(std::vector<Guid> const &guids);
+    bool match_guid_filter(std::string_view mapping_str) const;
     
     void add_default_mapping() {
       add_internal_mappings();
       add_user_mappings();
     }
 
+    // Enable lookup in the internal database (compiled in at build time)
     void add_internal_mappings();
 
-    // Add mapping into the database from environment database SDL_GAMECONTROLLERCONFIG
+    // Add mapping into the database from environment variables
+    // SDL_GAMECONTROLLERCONFIG_FILE and SDL_GAMECONTROLLERCONFIG
     void add_user_mappings();
 
-    ControllerMapping* get_mapping(std::string const &guid);
+    // Add memory mapped binary database (see bindb.h), the database added
+    // later takes precedence. Throws std::runtime_error on error.
+    void add_binary_mapping_db(std::string const &filename);
+    void add_binary_mapping_db(std::string const &filename, platform::MappedFile &&file);
+
+    ControllerMapping* get_mapping(Guid const &guid);
+    // Sorted guids of all mappings in all databases
+    std::vector<Guid> get_guids() const;
     ~SDLJoyMapping();
   protected:
-    std::unordered_map<std::string, ControllerMapping> mapping_db;
+    std::unordered_map<Guid, ControllerMapping, GuidHash> mapping_db;
+    bool use_internal_db = false;
+    std::vector<std::unique_ptr<BinaryMappingDb>> binary_dbs;
+    std::vector<Guid> guid_filter;   // sorted
 
   private:
     // Disable copy constructor and assign operator
@@ -180,14 +279,36 @@ struct HatEventType {
 
 struct EventButtonBinding
 {
-    const EventType *event;
-    const ButtonBinding *bind;
+    const EventType *event = nullptr;
+    const ButtonBinding *bind = nullptr;
 
     operator bool() const {
       return (event != nullptr) && (bind != nullptr);
     };
 };
 
+// Identity and capabilities of the event device, read from the opened
+// device (libevdev) or from sysfs (see SysfsInput)
+struct DeviceDescriptor
+{
+    std::string devname;    // Device path
+    std::string name;
+    uint16_t bustype = 0;
+    uint16_t vendor = 0;
+    uint16_t product = 0;
+    uint16_t version = 0;
+    Bitmap<KEY_CNT> key_bits;
+    Bitmap<ABS_CNT> abs_bits;
+
+    // SDL guid: bustype, vendor, product and version as little endian 16 bit
+    // words, each followed by zero word
+    void get_guid(joy_guid_t &guid) const;
+    Guid get_guid() const;
+    // Set bustype, vendor, product and version from the guid, false when the
+    // guid is not in the layout made by get_guid()
+    bool set_guid(const Guid &guid);
+};
+
 class EvdevJoystick
 {
   public:
@@ -199,22 +320,50 @@ class EvdevJoystick
     // Returns list of vector of event devices 
     static std::vector<std::string> get_event_devices();
 
+    // Open the devices concurrently by a small pool of threads. The result
+    // has the same order as devnames, nullptr for the device which failed,
+    // did not finish in the timeout (counted from the start of its probe,
+    // zero timeout waits without limit) or whose previous probe still runs.
+    static std::vector<std::unique_ptr<EvdevJoystick>> open_devices(
+        std::vector<std::string> const &devnames, std::chrono::milliseconds timeout);
+    // Call before every exit of the process. Waits up to timeout for the
+    // probes of open_devices() which did not finish in time. A probe blocked
+    // in the kernel cannot be joined, the process ends then by _Exit(status)
+    // without the destruction of the static objects, the exit status is
+    // the same as without the hung probe.
+    static void finish_probes(std::chrono::milliseconds timeout, int status);
+
+    // Throws std::runtime_error when the device cannot be opened
     EvdevJoystick(std::string const &devname);
-    std::string get_guid();
-    void get_guid(joy_guid_t &guid);
+    // Gamepad described by sysfs, the device is not opened
+    explicit EvdevJoystick(DeviceDescriptor const &descriptor);
+    Guid get_guid() const { return guid; }
+    void get_guid(joy_guid_t &guid) const { descriptor.get_guid(guid); }
+    const DeviceDescriptor& get_descriptor() const { return descriptor; }
+    // Opened device, nullptr for the gamepad described by sysfs or snapshot
+    struct libevdev* get_evdev() const { return evdev; }
+    // Range of the axis or hat read when the device was opened, nullptr
+    // when the device does not have it or was not opened
+    const struct input_absinfo* get_abs_info(unsigned int code) const;
 
     // The returned name is valid until EvdevJoystic is released
-    std::string_view get_name();
+    std::string_view get_name() const { return descriptor.name; }
 
-    /* Set mapping invalidate all existing pointers in EventButtonBinding */
+    /* Set mapping invalidate all existing pointers in EventButtonBinding,
+       only the binding table of the mapping is copied */
     void set_mapping(ControllerMapping const &mapping);
     bool set_mapping(SDLJoyMapping &joy_mapping);
-    EventButtonBinding get_event_binding(ControllerButton button);
+    EventButtonBinding get_event_binding(ControllerButton button) const;
     ~EvdevJoystick();
 
   protected:
-    ControllerMapping mapping;
+    ButtonBindingTable button_binding;
+    Guid guid;
     struct libevdev *evdev = nullptr;
+    DeviceDescriptor descriptor;
+    std::array<struct input_absinfo, ABS_CNT> abs_info{};
+    void get_capabilities();
+    void init_settings();
     void get_button_settings();
     void get_hat_settings();
     void get_axes_settings();
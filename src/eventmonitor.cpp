@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "eventmonitor.h"
+
+namespace evdevjoy {
+
+static const int MAX_EPOLL_EVENTS = 16;
+
+static int64_t get_time_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void EventHandler::on_frame(std::size_t gamepad, const struct input_event *events, std::size_t count)
+{
+    for (std::size_t i=0; i < count; i++) {
+        on_event(gamepad, events[i]);
+    }
+}
+
+EventMonitor::EventMonitor(ReadMode mode) :
+    mode(mode)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create epoll");
+    }
+}
+
+EventMonitor::~EventMonitor()
+{
+    close(epoll_fd);
+}
+
+std::size_t EventMonitor::add(const EvdevJoystick &gamepad)
+{
+    if (gamepad.get_evdev() == nullptr) {
+        throw std::runtime_error("Gamepad is not opened: " + gamepad.devname);
+    }
+    int fd = libevdev_get_fd(gamepad.get_evdev());
+
+    Device device;
+    device.gamepad = &gamepad;
+    device.evdev = gamepad.get_evdev();
+    device.fd = fd;
+    int clock = CLOCK_MONOTONIC;
+    device.monotonic = (ioctl(fd, EVIOCSCLOCKID, &clock) == 0);
+
+    std::size_t index = devices.size();
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot watch " + gamepad.devname);
+    }
+    if (mode == ReadMode::BATCH) {
+        device.buffer.resize(READ_BUFFER_EVENTS);
+    }
+    devices.push_back(std::move(device));
+    n_active++;
+    LOG(DEBUG) << "EventMonitor: gamepad " << index << " " << gamepad.devname;
+    return index;
+}
+
+bool EventMonitor::read_events(EventHandler &handler, int timeout_ms)
+{
+    struct epoll_event ready[MAX_EPOLL_EVENTS];
+    int n_ready = epoll_wait(epoll_fd, ready, MAX_EPOLL_EVENTS, timeout_ms);
+    if (n_ready < 0) {
+        if (errno == EINTR) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(), "Cannot wait for gamepads");
+    }
+    for (int i=0; i < n_ready; i++) {
+        std::size_t index = static_cast<std::size_t>(ready[i].data.u64);
+        read_device(index, handler);
+        // Hang up without the error from read, the device is never readable
+        if (devices[index].active && (ready[i].events & (EPOLLHUP | EPOLLERR))) {
+            LOG(INFO) << "EventMonitor: gamepad " << devices[index].gamepad->devname << " hang up";
+            remove(index, handler);
+        }
+    }
+    return n_ready > 0;
+}
+
+// Events of the device with CLOCK_REALTIME are moved to CLOCK_MONOTONIC
+static int64_t get_clock_offset(bool monotonic)
+{
+    return monotonic ? 0 : get_time_ns(CLOCK_MONOTONIC) - get_time_ns(CLOCK_REALTIME);
+}
+
+static void add_time_offset(struct input_event &ev, int64_t offset)
+{
+    int64_t time = int64_t(ev.input_event_sec) * 1000000000 +
+        int64_t(ev.input_event_usec) * 1000 + offset;
+    ev.input_event_sec = time / 1000000000;
+    ev.input_event_usec = (time % 1000000000) / 1000;
+}
+
+void EventMonitor::read_device(std::size_t index, EventHandler &handler)
+{
+    if (mode == ReadMode::LIBEVDEV) {
+        read_device_libevdev(index, handler);
+        return;
+    }
+
+    Device &device = devices[index];
+    int64_t offset = get_clock_offset(device.monotonic);
+    while (device.active) {
+        std::size_t space = device.buffer.size() - device.pending;
+        ssize_t n_read = read(device.fd, device.buffer.data() + device.pending,
+            space * sizeof(struct input_event));
+        stats.reads++;
+        if (n_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                LOG(INFO) << "EventMonitor: gamepad " << device.gamepad->devname
+                    << " removed: " << std::strerror(errno);
+                remove(index, handler);
+            }
+            break;
+        }
+
+        std::size_t n_events = static_cast<std::size_t>(n_read) / sizeof(struct input_event);
+        stats.events += n_events;
+        // Only the new events, the pending part of the frame has the offset
+        if (offset != 0) {
+            for (std::size_t i=device.pending; i < device.pending + n_events; i++) {
+                add_time_offset(device.buffer[i], offset);
+            }
+        }
+        device.pending = pass_frames(index, device.pending + n_events, handler);
+        // Short read: nothing more is available, EOF of the hang up device is
+        // handled by EPOLLHUP
+        if (n_events < space) {
+            break;
+        }
+    }
+}
+
+std::size_t EventMonitor::pass_frames(std::size_t index, std::size_t count, EventHandler &handler)
+{
+    Device &device = devices[index];
+    struct input_event *events = device.buffer.data();
+    std::size_t first = 0;
+    for (std::size_t i=0; i < count; i++) {
+        const struct input_event &ev = events[i];
+        if (ev.type != EV_SYN) {
+            continue;
+        }
+        if (ev.code == SYN_REPORT) {
+            handler.on_frame(index, events + first, i + 1 - first);
+            stats.frames++;
+            first = i + 1;
+        } else if (ev.code == SYN_DROPPED) {
+            // The rest of the buffer is older than the state read by libevdev
+            stats.drops++;
+            resync(index, handler);
+            return 0;
+        }
+    }
+
+    std::size_t left = count - first;
+    if (left == device.buffer.size()) {
+        // Frame longer than the buffer is passed in parts
+        handler.on_frame(index, events, left);
+        return 0;
+    }
+    if ((left > 0) && (first > 0)) {
+        std::memmove(events, events + first, left * sizeof(struct input_event));
+    }
+    return left;
+}
+
+void EventMonitor::resync(std::size_t index, EventHandler &handler)
+{
+    Device &device = devices[index];
+    LOG(DEBUG) << "EventMonitor: gamepad " << device.gamepad->devname << " dropped events";
+
+    // The device is drained and libevdev queues the differences to its
+    // state, the events are only applied to the state of libevdev
+    struct input_event ev;
+    libevdev_next_event(device.evdev, LIBEVDEV_READ_FLAG_FORCE_SYNC, &ev);
+    int rc;
+    do {
+        rc = libevdev_next_event(device.evdev, LIBEVDEV_READ_FLAG_SYNC, &ev);
+    } while ((rc == LIBEVDEV_READ_STATUS_SYNC) || (rc == -EINTR));
+
+    // State of the gamepad, the handler ignores the values which were not
+    // changed
+    std::vector<struct input_event> &frame = device.buffer;
+    frame.clear();
+    int64_t time = get_time_ns(CLOCK_MONOTONIC);
+    auto add_event = [&frame, &device, time](unsigned int type, unsigned int code) {
+        struct input_event ev = {};
+        ev.input_event_sec = time / 1000000000;
+        ev.input_event_usec = (time % 1000000000) / 1000;
+        ev.type = type;
+        ev.code = code;
+        ev.value = libevdev_get_event_value(device.evdev, type, code);
+        frame.push_back(ev);
+    };
+    const EvdevJoystick &gamepad = *device.gamepad;
+    for (auto const &button : gamepad.buttons) {
+        add_event(button.type, button.code);
+    }
+    for (auto const &hat : gamepad.hats) {
+        add_event(hat.x.type, hat.x.code);
+        add_event(hat.y.type, hat.y.code);
+    }
+    for (auto const &axis : gamepad.axes) {
+        add_event(axis.type, axis.code);
+    }
+    add_event(EV_SYN, SYN_REPORT);
+
+    handler.on_frame(index, frame.data(), frame.size());
+    stats.frames++;
+    frame.resize(std::max(frame.size(), READ_BUFFER_EVENTS));
+}
+
+void EventMonitor::read_device_libevdev(std::size_t index, EventHandler &handler)
+{
+    Device &device = devices[index];
+    int64_t offset = get_clock_offset(device.monotonic);
+
+    unsigned int flags = LIBEVDEV_READ_FLAG_NORMAL;
+    while (device.active) {
+        struct input_event ev;
+        int rc = libevdev_next_event(device.evdev, flags, &ev);
+        if ((rc == LIBEVDEV_READ_STATUS_SYNC) || (rc == LIBEVDEV_READ_STATUS_SUCCESS)) {
+            // After SYN_DROPPED libevdev reports the differences to the
+            // current state of the device
+            if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+                if (flags != LIBEVDEV_READ_FLAG_SYNC) {
+                    stats.drops++;
+                }
+                flags = LIBEVDEV_READ_FLAG_SYNC;
+            }
+            if (offset != 0) {
+                add_time_offset(ev, offset);
+            }
+            stats.events++;
+            if ((ev.type == EV_SYN) && (ev.code == SYN_REPORT)) {
+                stats.frames++;
+            }
+            handler.on_event(index, ev);
+        } else if ((rc == -EAGAIN) && (flags == LIBEVDEV_READ_FLAG_SYNC)) {
+            flags = LIBEVDEV_READ_FLAG_NORMAL;
+        } else if (rc == -EAGAIN) {
+            break;
+        } else if (rc != -EINTR) {
+            LOG(INFO) << "EventMonitor: gamepad " << device.gamepad->devname
+                << " removed: " << std::strerror(-rc);
+            remove(index, handler);
+        }
+    }
+}
+
+void EventMonitor::remove(std::size_t index, EventHandler &handler)
+{
+    Device &device = devices[index];
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device.fd, nullptr);
+    device.active = false;
+    n_active--;
+    handler.on_removed(index);
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,112 @@
+#ifndef __EVENTMONITOR_H
+#define __EVENTMONITOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <linux/input.h>
+#include "evdevjoy.h"
+
+namespace evdevjoy {
+
+// Receiver of the input events read by EventMonitor, gamepad is the index
+// returned by EventMonitor::add()
+class EventHandler
+{
+  public:
+    virtual ~EventHandler() = default;
+    // Time of the event is CLOCK_MONOTONIC
+    virtual void on_event(std::size_t gamepad, const struct input_event &ev) = 0;
+    // Events of one frame, the last one is SYN_REPORT (except the frame
+    // which does not fit into the read buffer). Calls on_event() by default.
+    virtual void on_frame(std::size_t gamepad, const struct input_event *events, std::size_t count);
+    virtual void on_removed(std::size_t gamepad) = 0;
+};
+
+// Input events of all opened gamepads (options --monitor, --remap). The
+// devices are waited for in one epoll set, the readable device is read
+// until it is drained, the events are passed to EventHandler (e.g.
+// RemapEngine). The device clock is switched to CLOCK_MONOTONIC, events of
+// the device which does not support it are converted.
+//
+// ReadMode::BATCH reads the arrays of input_event by read() into the buffer
+// of the device and passes whole frames to the handler, the short read
+// means the device is drained (no read ending by EAGAIN). After SYN_DROPPED
+// the state is synchronized by libevdev and passed as one frame with all
+// buttons and axes of the gamepad. ReadMode::LIBEVDEV reads one event per
+// libevdev_next_event() call, kept for the comparison (bench_evread).
+class EventMonitor
+{
+  public:
+    enum class ReadMode { BATCH, LIBEVDEV };
+
+    // Counters of all gamepads
+    struct Stats
+    {
+        uint64_t reads = 0;     // read() calls, only ReadMode::BATCH
+        uint64_t events = 0;
+        uint64_t frames = 0;
+        uint64_t drops = 0;     // SYN_DROPPED
+    };
+
+    // Throws std::system_error
+    explicit EventMonitor(ReadMode mode = ReadMode::BATCH);
+    ~EventMonitor();
+
+    // The gamepad must be opened (not sysfs or snapshot) and valid until the
+    // monitor is released, returns the index of the gamepad in the events.
+    // Throws std::runtime_error.
+    std::size_t add(const EvdevJoystick &gamepad);
+    // Number of gamepads which are not removed
+    std::size_t size() const { return n_active; }
+
+    // Wait up to timeout_ms (-1 without limit) and pass the events of all
+    // readable gamepads to the handler, returns false on timeout or signal.
+    // Disconnected gamepad is reported by on_removed() and it is not waited
+    // for anymore. Throws std::system_error.
+    bool read_events(EventHandler &handler, int timeout_ms = -1);
+
+    const Stats& get_stats() const { return stats; }
+
+  protected:
+    // Size of the read buffer of one device, frame of a gamepad has usually
+    // up to 10 events
+    static const std::size_t READ_BUFFER_EVENTS = 128;
+
+    struct Device
+    {
+        const EvdevJoystick *gamepad;
+        struct libevdev *evdev;
+        int fd;
+        bool active = true;
+        bool monotonic;     // event time is CLOCK_MONOTONIC
+        // Events of the incomplete frame from the last read stay at the start
+        std::vector<struct input_event> buffer;
+        std::size_t pending = 0;
+    };
+
+    ReadMode mode;
+    int epoll_fd = -1;
+    std::vector<Device> devices;
+    std::size_t n_active = 0;
+    Stats stats;
+
+    void read_device(std::size_t index, EventHandler &handler);
+    void read_device_libevdev(std::size_t index, EventHandler &handler);
+    // Pass the complete frames of buffer[0, count), returns the number of
+    // events left (incomplete frame) which are moved to the start
+    std::size_t pass_frames(std::size_t index, std::size_t count, EventHandler &handler);
+    // After SYN_DROPPED: libevdev drains the device and reads its state,
+    // the handler gets one frame with the values of all buttons and axes
+    void resync(std::size_t index, EventHandler &handler);
+    void remove(std::size_t index, EventHandler &handler);
+
+  private:
+    // Disable copy constructor and assign operator
+    EventMonitor(const EventMonitor&) = delete;
+    EventMonitor& operator=(const EventMonitor&) = delete;
+};
+
+} // namespace evdevjoy
+#endif
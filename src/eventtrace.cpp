@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "eventtrace.h"
+
+namespace evdevjoy {
+
+static int64_t get_monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TraceWriter
+//////////////////////////////////////////////////////////////////////////
+
+TraceWriter::TraceWriter(const std::string &filename,
+        const std::vector<const EvdevJoystick*> &gamepads) :
+    filename(filename)
+{
+    using namespace trace;
+
+    if (gamepads.size() > 256) {
+        throw std::runtime_error("Too many gamepads for trace: " + filename);
+    }
+
+    std::vector<DeviceRecord> records;
+    std::string strings;
+    for (auto const gamepad : gamepads) {
+        const DeviceDescriptor &descriptor = gamepad->get_descriptor();
+        DeviceRecord record = {};
+        record.bustype = descriptor.bustype;
+        record.vendor = descriptor.vendor;
+        record.product = descriptor.product;
+        record.version = descriptor.version;
+
+        record.name_offset = static_cast<uint32_t>(strings.size());
+        record.name_length = static_cast<uint16_t>(std::min<std::size_t>(descriptor.name.size(), UINT16_MAX));
+        strings.append(descriptor.name, 0, record.name_length);
+        record.devname_offset = static_cast<uint32_t>(strings.size());
+        record.devname_length = static_cast<uint16_t>(std::min<std::size_t>(gamepad->devname.size(), UINT16_MAX));
+        strings.append(gamepad->devname, 0, record.devname_length);
+
+        descriptor.key_bits.for_each(0, KEY_CNT, [&record](std::size_t bit) {
+            record.key_bits[bit / 8] |= 1 << (bit % 8);
+        });
+        descriptor.abs_bits.for_each(0, ABS_CNT, [&record, gamepad](std::size_t bit) {
+            record.abs_bits[bit / 8] |= 1 << (bit % 8);
+            const struct input_absinfo *absinfo = gamepad->get_abs_info(bit);
+            if (absinfo != nullptr) {
+                record.abs_info[bit] = *absinfo;
+            }
+        });
+        records.push_back(record);
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.device_count = static_cast<uint32_t>(records.size());
+    header.strings_size = static_cast<uint32_t>(strings.size());
+    header.devices_offset = sizeof(FileHeader);
+    header.strings_offset = header.devices_offset + header.device_count * sizeof(DeviceRecord);
+    // Events are aligned
+    header.events_offset = (header.strings_offset + header.strings_size + alignof(EventRecord) - 1)
+        & ~uint32_t(alignof(EventRecord) - 1);
+    strings.resize(header.events_offset - header.strings_offset, '\0');
+
+    fout.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!fout) {
+        throw std::runtime_error("Cannot create trace '" + filename + "'");
+    }
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(DeviceRecord));
+    fout.write(strings.data(), strings.size());
+    if (!fout) {
+        throw std::runtime_error("Error during writing trace '" + filename + "'");
+    }
+}
+
+TraceWriter::~TraceWriter()
+{
+    if (fout.is_open()) {
+        fout.close();
+    }
+}
+
+void TraceWriter::write(const trace::EventRecord &record)
+{
+    fout.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    event_count++;
+}
+
+void TraceWriter::on_event(std::size_t gamepad, const struct input_event &ev)
+{
+    int64_t time = int64_t(ev.input_event_sec) * 1000000000 + int64_t(ev.input_event_usec) * 1000;
+    if (start_time < 0) {
+        start_time = time;
+    }
+    // Events of the gamepads are ordered by the arrival
+    last_time = std::max(last_time, time - start_time);
+
+    trace::EventRecord record = {};
+    record.time = last_time;
+    record.value = ev.value;
+    record.code = ev.code;
+    record.type = static_cast<uint8_t>(ev.type);
+    record.device = static_cast<uint8_t>(gamepad);
+    write(record);
+}
+
+void TraceWriter::on_removed(std::size_t gamepad)
+{
+    trace::EventRecord record = {};
+    record.time = (start_time < 0) ? 0 : std::max(last_time, get_monotonic_ns() - start_time);
+    record.type = trace::TYPE_REMOVED;
+    record.device = static_cast<uint8_t>(gamepad);
+    write(record);
+}
+
+void TraceWriter::close()
+{
+    fout.close();
+    if (!fout) {
+        throw std::runtime_error("Error during writing trace '" + filename + "'");
+    }
+    LOG(INFO) << "TraceWriter: " << event_count << " events written into: " << filename;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TraceReader
+//////////////////////////////////////////////////////////////////////////
+
+TraceReader::TraceReader(const std::string &filename) :
+    filename(filename)
+{
+    using namespace trace;
+
+    try {
+        file = platform::MappedFile(filename);
+    } catch (const std::system_error &e) {
+        LOG(ERROR) << "TraceReader: " << e.what();
+        throw std::runtime_error(e.what());
+    }
+
+    if ((file.size() < sizeof(FileHeader)) ||
+        (std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0))
+    {
+        throw std::runtime_error("Not an event trace: " + filename);
+    }
+    const FileHeader *header = reinterpret_cast<const FileHeader*>(file.data());
+    if (header->byte_order != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Unsupported byte order of event trace: " + filename);
+    }
+    if (header->version != VERSION) {
+        throw std::runtime_error("Unsupported version of event trace: " + filename);
+    }
+
+    uint64_t devices_end = uint64_t(header->devices_offset)
+        + uint64_t(header->device_count) * sizeof(DeviceRecord);
+    uint64_t strings_end = uint64_t(header->strings_offset) + header->strings_size;
+    if ((devices_end > file.size()) || (strings_end > file.size()) ||
+        (header->events_offset > file.size()) || (header->device_count > 256) ||
+        (header->devices_offset % alignof(DeviceRecord) != 0) ||
+        (header->events_offset % alignof(EventRecord) != 0))
+    {
+        throw std::runtime_error("Corrupted event trace: " + filename);
+    }
+
+    const DeviceRecord *records = reinterpret_cast<const DeviceRecord*>(file.data() + header->devices_offset);
+    const char *strings = file.data() + header->strings_offset;
+    for (uint32_t i=0; i < header->device_count; i++) {
+        const DeviceRecord &record = records[i];
+        if ((uint64_t(record.name_offset) + record.name_length > header->strings_size) ||
+            (uint64_t(record.devname_offset) + record.devname_length > header->strings_size))
+        {
+            throw std::runtime_error("Corrupted event trace: " + filename);
+        }
+
+        TraceDevice device;
+        DeviceDescriptor &descriptor = device.descriptor;
+        descriptor.bustype = record.bustype;
+        descriptor.vendor = record.vendor;
+        descriptor.product = record.product;
+        descriptor.version = record.version;
+        descriptor.name.assign(strings + record.name_offset, record.name_length);
+        descriptor.devname.assign(strings + record.devname_offset, record.devname_length);
+        for (unsigned int bit=0; bit < KEY_CNT; bit++) {
+            if (record.key_bits[bit / 8] & (1 << (bit % 8))) {
+                descriptor.key_bits.set(bit);
+            }
+        }
+        for (unsigned int bit=0; bit < ABS_CNT; bit++) {
+            if (record.abs_bits[bit / 8] & (1 << (bit % 8))) {
+                descriptor.abs_bits.set(bit);
+                device.abs_info[bit] = record.abs_info[bit];
+            }
+        }
+        devices.push_back(std::move(device));
+    }
+
+    events_begin = reinterpret_cast<const EventRecord*>(file.data() + header->events_offset);
+    event_count = (file.size() - header->events_offset) / sizeof(EventRecord);
+    for (std::size_t i=0; i < event_count; i++) {
+        if (events_begin[i].device >= devices.size()) {
+            throw std::runtime_error("Corrupted event trace: " + filename);
+        }
+    }
+
+    LOG(INFO) << "TraceReader: " << devices.size() << " gamepads, " << event_count
+        << " events from: " << filename;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// TraceReplay
+//////////////////////////////////////////////////////////////////////////
+
+TraceReplay::TraceReplay(const TraceReader &reader, double speed) :
+    reader(reader),
+    speed(speed)
+{
+}
+
+bool TraceReplay::play_frame(EventHandler &handler)
+{
+    if (position >= reader.size()) {
+        return false;
+    }
+    if (start_time < 0) {
+        start_time = get_monotonic_ns();
+    }
+
+    const trace::EventRecord *events = reader.events();
+    int64_t time;
+    if (speed > 0) {
+        time = start_time + static_cast<int64_t>(events[position].time / speed);
+        struct timespec ts;
+        ts.tv_sec = time / 1000000000;
+        ts.tv_nsec = time % 1000000000;
+        int rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+        if (rc == EINTR) {
+            return true;
+        }
+        if (rc != 0) {
+            throw std::system_error(rc, std::generic_category(), "Cannot wait for the event");
+        }
+    } else {
+        time = get_monotonic_ns();
+    }
+
+    if (events[position].type == trace::TYPE_REMOVED) {
+        handler.on_removed(events[position++].device);
+        return true;
+    }
+
+    // Events of one device up to SYN_REPORT
+    std::size_t device = events[position].device;
+    struct input_event ev = {};
+    ev.input_event_sec = time / 1000000000;
+    ev.input_event_usec = (time % 1000000000) / 1000;
+    frame.clear();
+    while ((position < reader.size()) && (events[position].device == device) &&
+        (events[position].type != trace::TYPE_REMOVED))
+    {
+        const trace::EventRecord &record = events[position++];
+        ev.type = record.type;
+        ev.code = record.code;
+        ev.value = record.value;
+        frame.push_back(ev);
+        if ((record.type == EV_SYN) && (record.code == SYN_REPORT)) {
+            break;
+        }
+    }
+    handler.on_frame(device, frame.data(), frame.size());
+    return true;
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,164 @@
+#ifndef __EVENTTRACE_H
+#define __EVENTTRACE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <linux/input.h>
+
+#include "evdevjoy.h"
+#include "eventmonitor.h"
+#include "mmapfile.h"
+
+namespace evdevjoy {
+
+// Binary trace of the input events (options --record, --replay). The
+// gamepads are described in the file, the trace is replayed without the
+// hardware. The file is memory mapped and replayed without parsing:
+//
+//   FileHeader
+//   DeviceRecord[device_count]
+//   char strings[strings_size]     names and device paths, not null terminated
+//   EventRecord[]                  until the end of the file
+//
+// The count of the events is not stored, the trace of the interrupted
+// recording is valid up to the last complete event. All integers are stored
+// in the byte order of the machine which created the file.
+namespace trace {
+    const char MAGIC[8] = {'S', 'X', 'B', 'T', 'R', 'A', 'C', 'E'};
+    const uint32_t VERSION = 1;
+    const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    // EventRecord::type of the disconnected gamepad
+    const uint8_t TYPE_REMOVED = 0xff;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t device_count;
+        uint32_t strings_size;
+        uint32_t devices_offset;
+        uint32_t strings_offset;
+        uint32_t events_offset;
+        uint32_t reserved;
+    };
+
+    struct DeviceRecord
+    {
+        uint16_t bustype;
+        uint16_t vendor;
+        uint16_t product;
+        uint16_t version;
+        uint32_t name_offset;
+        uint32_t devname_offset;
+        uint16_t name_length;
+        uint16_t devname_length;
+        uint32_t reserved;
+        uint8_t key_bits[KEY_CNT / 8];
+        uint8_t abs_bits[ABS_CNT / 8];
+        struct input_absinfo abs_info[ABS_CNT];
+    };
+
+    struct EventRecord
+    {
+        int64_t time;               // ns from the start of the recording
+        int32_t value;
+        uint16_t code;
+        uint8_t type;               // EV_*, TYPE_REMOVED
+        uint8_t device;             // index of DeviceRecord
+    };
+
+    static_assert(sizeof(FileHeader) == 40, "Unexpected size of trace::FileHeader");
+    static_assert(sizeof(DeviceRecord) % 8 == 0, "Unexpected size of trace::DeviceRecord");
+    static_assert(sizeof(EventRecord) == 16, "Unexpected size of trace::EventRecord");
+}
+
+// Gamepad of the trace
+struct TraceDevice
+{
+    DeviceDescriptor descriptor;
+    // Only the axes and hats of descriptor.abs_bits are valid
+    std::array<struct input_absinfo, ABS_CNT> abs_info{};
+};
+
+// Records the events of the gamepads into the trace file (option --record).
+// It is EventHandler of EventMonitor, the gamepads must be given in the
+// order of EventMonitor::add().
+class TraceWriter : public EventHandler
+{
+  public:
+    // Throws std::runtime_error when the file cannot be created or there
+    // are more than 256 gamepads
+    TraceWriter(const std::string &filename, const std::vector<const EvdevJoystick*> &gamepads);
+    ~TraceWriter() override;
+
+    void on_event(std::size_t gamepad, const struct input_event &ev) override;
+    void on_removed(std::size_t gamepad) override;
+    // Flush the file, throws std::runtime_error on write error
+    void close();
+
+    std::size_t get_event_count() const { return event_count; }
+
+  protected:
+    std::string filename;
+    std::ofstream fout;
+    int64_t start_time = -1;    // time of the first event
+    int64_t last_time = 0;
+    std::size_t event_count = 0;
+
+    void write(const trace::EventRecord &record);
+};
+
+// Memory mapped trace file (option --replay)
+class TraceReader
+{
+  public:
+    // Throws std::runtime_error when the file cannot be opened or has
+    // unexpected format
+    explicit TraceReader(const std::string &filename);
+
+    const std::vector<TraceDevice>& get_devices() const { return devices; }
+    const trace::EventRecord* events() const { return events_begin; }
+    std::size_t size() const { return event_count; }
+    // Time of the last event, ns
+    int64_t get_duration() const { return (event_count > 0) ? events_begin[event_count - 1].time : 0; }
+
+  protected:
+    std::string filename;
+    platform::MappedFile file;
+    std::vector<TraceDevice> devices;
+    const trace::EventRecord *events_begin = nullptr;
+    std::size_t event_count = 0;
+};
+
+// Replays the trace into EventHandler one frame (events up to SYN_REPORT)
+// at a time, the index of the gamepad is the index of the trace device.
+// Time of the delivered events is the CLOCK_MONOTONIC time of the delivery,
+// so the latency measured by the handler is the latency of the processing.
+class TraceReplay
+{
+  public:
+    // speed: 1 for the recorded timing, 2 twice faster etc., 0 without
+    // waiting (maximum speed)
+    TraceReplay(const TraceReader &reader, double speed);
+
+    // Wait for the next frame and pass it to the handler. Returns false at
+    // the end of the trace, true also when the wait was interrupted by
+    // a signal and nothing was delivered.
+    bool play_frame(EventHandler &handler);
+    std::size_t get_position() const { return position; }
+
+  protected:
+    const TraceReader &reader;
+    double speed;
+    int64_t start_time = -1;    // CLOCK_MONOTONIC of the trace start
+    std::size_t position = 0;
+    std::vector<struct input_event> frame;
+};
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,21 @@
+#include <ostream>
+
+#include "guid.h"
+
+namespace evdevjoy {
+
+std::string Guid::to_string() const
+{
+    std::string result(STRING_LENGTH, '0');
+    to_chars(result.data());
+    return result;
+}
+
+std::ostream& operator<<(std::ostream &os, const Guid &guid)
+{
+    char buffer[Guid::STRING_LENGTH];
+    guid.to_chars(buffer);
+    return os.write(buffer, sizeof(buffer));
+}
+
+} // namespace evdevjoy
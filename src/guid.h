@@ -0,0 +1,148 @@
+#ifndef __GUID_H
+#define __GUID_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace evdevjoy {
+
+// SDL joystick guid, 16 bytes stored as two integers. The first byte of the
+// guid is the most significant byte of hi, so the integer order is the same
+// as the order of the 32 characters hex strings.
+struct Guid
+{
+    static const std::size_t STRING_LENGTH = 32;
+
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    constexpr Guid() = default;
+    constexpr Guid(uint64_t hi, uint64_t lo) : hi(hi), lo(lo) {}
+
+    static Guid from_bytes(const uint8_t *bytes);
+    void to_bytes(uint8_t *bytes) const;
+
+    // Decode 32 hex characters (lower or upper case), returns false when the
+    // text is not a valid guid
+    static bool from_string(std::string_view text, Guid &guid);
+    // Write 32 lowercase hex characters, no null terminator
+    void to_chars(char *out) const;
+    std::string to_string() const;
+
+    std::size_t hash() const {
+        uint64_t h = (hi ^ (lo * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    constexpr bool empty() const { return (hi | lo) == 0; }
+};
+
+constexpr bool operator==(const Guid &a, const Guid &b) {
+    return ((a.hi ^ b.hi) | (a.lo ^ b.lo)) == 0;
+}
+
+constexpr bool operator!=(const Guid &a, const Guid &b) {
+    return !(a == b);
+}
+
+constexpr bool operator<(const Guid &a, const Guid &b) {
+    return (a.hi < b.hi) || ((a.hi == b.hi) && (a.lo < b.lo));
+}
+
+std::ostream& operator<<(std::ostream &os, const Guid &guid);
+
+struct GuidHash
+{
+    std::size_t operator()(const Guid &guid) const { return guid.hash(); }
+};
+
+namespace guid_detail {
+    // Value of the hex digit, 0x10 marks invalid character
+    constexpr std::array<uint8_t, 256> make_hex_table() {
+        std::array<uint8_t, 256> table = {};
+        for (int c=0; c < 256; c++) {
+            if ((c >= '0') && (c <= '9')) table[c] = c - '0';
+            else if ((c >= 'a') && (c <= 'f')) table[c] = c - 'a' + 10;
+            else if ((c >= 'A') && (c <= 'F')) table[c] = c - 'A' + 10;
+            else table[c] = 0x10;
+        }
+        return table;
+    }
+    constexpr std::array<uint8_t, 256> HEX_TABLE = make_hex_table();
+
+    inline uint64_t load_be64(const uint8_t *bytes) {
+        uint64_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        value = __builtin_bswap64(value);
+#endif
+        return value;
+    }
+
+    inline void store_be64(uint64_t value, uint8_t *bytes) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        value = __builtin_bswap64(value);
+#endif
+        std::memcpy(bytes, &value, sizeof(value));
+    }
+
+    // 16 hex characters into integer, invalid characters are collected in bad
+    inline uint64_t decode16(const char *text, uint8_t &bad) {
+        uint64_t value = 0;
+        for (int i=0; i < 16; i++) {
+            uint8_t digit = HEX_TABLE[static_cast<uint8_t>(text[i])];
+            bad |= digit;
+            value = (value << 4) | (digit & 0x0f);
+        }
+        return value;
+    }
+
+    // Integer into 16 lowercase hex characters
+    inline void encode16(uint64_t value, char *out) {
+        for (int i=15; i >= 0; i--) {
+            int nibble = static_cast<int>(value & 0x0f);
+            // add 'a'-'0'-10 for nibbles 10..15 without branch
+            out[i] = static_cast<char>('0' + nibble + (((9 - nibble) >> 8) & 39));
+            value >>= 4;
+        }
+    }
+}
+
+inline Guid Guid::from_bytes(const uint8_t *bytes)
+{
+    return Guid(guid_detail::load_be64(bytes), guid_detail::load_be64(bytes + 8));
+}
+
+inline void Guid::to_bytes(uint8_t *bytes) const
+{
+    guid_detail::store_be64(hi, bytes);
+    guid_detail::store_be64(lo, bytes + 8);
+}
+
+inline bool Guid::from_string(std::string_view text, Guid &guid)
+{
+    if (text.size() != STRING_LENGTH) {
+        return false;
+    }
+    uint8_t bad = 0;
+    uint64_t hi = guid_detail::decode16(text.data(), bad);
+    uint64_t lo = guid_detail::decode16(text.data() + 16, bad);
+    if (bad & 0x10) {
+        return false;
+    }
+    guid = Guid(hi, lo);
+    return true;
+}
+
+inline void Guid::to_chars(char *out) const
+{
+    guid_detail::encode16(hi, out);
+    guid_detail::encode16(lo, out + 16);
+}
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "hotplug.h"
+#include "stringext.h"
+
+namespace fs = std::filesystem;
+
+namespace evdevjoy {
+
+static const std::string_view JOYSTICK_SUFFIX = "event-joystick";
+
+HotplugMonitor::HotplugMonitor(std::string dev_root)
+    : dev_root(dev_root), by_path(dev_root + "/by-path")
+{
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot initialize inotify");
+    }
+
+    wd_root = inotify_add_watch(fd, dev_root.c_str(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd_root < 0) {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "Cannot watch '" + dev_root + "'");
+    }
+    if (!watch_by_path()) {
+        LOG(INFO) << "HotplugMonitor: " << by_path << " does not exist, wait for the first device";
+    }
+}
+
+HotplugMonitor::~HotplugMonitor()
+{
+    close(fd);
+}
+
+bool HotplugMonitor::watch_by_path()
+{
+    wd_by_path = inotify_add_watch(fd, by_path.c_str(),
+        IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_ONLYDIR);
+    return wd_by_path >= 0;
+}
+
+void HotplugMonitor::read_events(std::vector<Event> &events, bool wait)
+{
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+
+    while (true) {
+        length = read(fd, buffer, sizeof(buffer));
+        if (length > 0) {
+            break;
+        }
+        if ((length < 0) && (errno == EINTR)) {
+            continue;
+        }
+        if ((length < 0) && (errno != EAGAIN)) {
+            throw std::system_error(errno, std::generic_category(), "Cannot read inotify events");
+        }
+        if (!wait) {
+            return;
+        }
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if ((poll(&pfd, 1, -1) < 0) && (errno != EINTR)) {
+            throw std::system_error(errno, std::generic_category(), "Cannot wait for inotify events");
+        }
+    }
+
+    for (char *p = buffer; p < buffer + length; ) {
+        const struct inotify_event *event = reinterpret_cast<const struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + event->len;
+        std::string_view name = (event->len > 0) ? std::string_view(event->name) : std::string_view();
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            LOG(WARNING) << "HotplugMonitor: inotify queue overflow";
+            events.push_back(Event{Action::RESCAN, ""});
+        } else if (event->wd == wd_root) {
+            if ((name == "by-path") && (event->mask & IN_ISDIR) && watch_by_path()) {
+                events.push_back(Event{Action::RESCAN, ""});
+            }
+        } else if (event->wd == wd_by_path) {
+            if (event->mask & IN_IGNORED) {
+                // Directory removed with the last device
+                wd_by_path = -1;
+                events.push_back(Event{Action::RESCAN, ""});
+            } else if (string::endswith(name, JOYSTICK_SUFFIX)) {
+                Action action = (event->mask & (IN_CREATE | IN_MOVED_TO)) ? Action::ADD : Action::REMOVE;
+                events.push_back(Event{action, by_path + "/" + std::string(name)});
+            }
+        }
+    }
+}
+
+std::vector<std::string> HotplugMonitor::get_devices() const
+{
+    std::vector<std::string> devices;
+    std::error_code ec;
+
+    for (auto const &entry : fs::directory_iterator(by_path, ec)) {
+        std::string filename = entry.path().u8string();
+        if (string::endswith(filename, JOYSTICK_SUFFIX)) {
+            devices.push_back(filename);
+        }
+    }
+    std::sort(devices.begin(), devices.end());
+    return devices;
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,58 @@
+#ifndef __HOTPLUG_H
+#define __HOTPLUG_H
+
+#include <string>
+#include <vector>
+
+namespace evdevjoy {
+
+// Arrival and removal of the joysticks, inotify watch of the event-joystick
+// links in <dev_root>/by-path (created by udev). The directory is watched
+// also when it does not exist yet, udev removes it with the last device.
+class HotplugMonitor
+{
+  public:
+    enum class Action
+    {
+        ADD,        // link created, devname is the link
+        REMOVE,     // link removed
+        RESCAN      // events lost or the directory (re)created, list all links
+    };
+
+    struct Event
+    {
+        Action action;
+        std::string devname;
+    };
+
+    // Throws std::system_error when inotify cannot be initialized
+    explicit HotplugMonitor(std::string dev_root = "/dev/input");
+    ~HotplugMonitor();
+
+    // inotify file descriptor, readable when there are events
+    int get_fd() const { return fd; }
+
+    // Append the events to the list, blocks until there is at least one
+    // event when wait is true. Throws std::system_error.
+    void read_events(std::vector<Event> &events, bool wait = true);
+
+    // Links of the connected joysticks, empty when the directory does not exist
+    std::vector<std::string> get_devices() const;
+
+  protected:
+    std::string dev_root;
+    std::string by_path;
+    int fd = -1;
+    int wd_root = -1;       // watch of dev_root, creation of by-path
+    int wd_by_path = -1;
+
+    bool watch_by_path();
+
+  private:
+    // Disable copy constructor and assign operator
+    HotplugMonitor(const HotplugMonitor&) = delete;
+    HotplugMonitor& operator=(const HotplugMonitor&) = delete;
+};
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <system_error>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "iovecbuffer.h"
+
+namespace platform {
+
+void IovecBuffer::append(std::string_view text)
+{
+    if (text.empty()) {
+        return;
+    }
+    char *base = const_cast<char*>(text.data());
+    if (join && !segments.empty()) {
+        struct iovec &last = segments.back();
+        if (static_cast<char*>(last.iov_base) + last.iov_len == base) {
+            last.iov_len += text.size();
+            n_bytes += text.size();
+            return;
+        }
+    }
+    segments.push_back(iovec{base, text.size()});
+    n_bytes += text.size();
+    join = true;
+}
+
+void IovecBuffer::insert(std::size_t position, std::string_view text)
+{
+    if (text.empty()) {
+        return;
+    }
+    segments.insert(segments.begin() + position,
+        iovec{const_cast<char*>(text.data()), text.size()});
+    n_bytes += text.size();
+}
+
+void IovecBuffer::clear()
+{
+    segments.clear();
+    n_bytes = 0;
+    join = true;
+}
+
+std::string IovecBuffer::str() const
+{
+    std::string result;
+    result.reserve(n_bytes);
+    for (auto const &segment : segments) {
+        result.append(static_cast<const char*>(segment.iov_base), segment.iov_len);
+    }
+    return result;
+}
+
+void IovecBuffer::write(int fd) const
+{
+    // Copy of the segments, partially written segment is adjusted
+    std::vector<struct iovec> iov(segments);
+    std::size_t i_first = 0;
+
+    while (i_first < iov.size()) {
+        int count = static_cast<int>(std::min<std::size_t>(iov.size() - i_first, IOV_MAX));
+        ssize_t written = writev(fd, &iov[i_first], count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Cannot write file");
+        }
+
+        std::size_t remaining = static_cast<std::size_t>(written);
+        while ((i_first < iov.size()) && (remaining >= iov[i_first].iov_len)) {
+            remaining -= iov[i_first].iov_len;
+            i_first++;
+        }
+        if (remaining > 0) {
+            iov[i_first].iov_base = static_cast<char*>(iov[i_first].iov_base) + remaining;
+            iov[i_first].iov_len -= remaining;
+        }
+    }
+}
+
+void IovecBuffer::write(const std::string &filename) const
+{
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+            "Cannot create file '" + filename + "'");
+    }
+    try {
+        write(fd);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    if (close(fd) < 0) {
+        throw std::system_error(errno, std::generic_category(),
+            "Cannot close file '" + filename + "'");
+    }
+}
+
+bool IovecBuffer::equals(int fd) const
+{
+    char buffer[16384];
+    for (auto const &segment : segments) {
+        const char *data = static_cast<const char*>(segment.iov_base);
+        std::size_t done = 0;
+        while (done < segment.iov_len) {
+            std::size_t length = std::min(sizeof(buffer), segment.iov_len - done);
+            ssize_t n = read(fd, buffer, length);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "Cannot read file");
+            }
+            if ((n == 0) || (std::memcmp(buffer, data + done, n) != 0)) {
+                return false;
+            }
+            done += n;
+        }
+    }
+    // The file must not be longer
+    ssize_t n;
+    while (((n = read(fd, buffer, 1)) < 0) && (errno == EINTR)) {
+    }
+    if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot read file");
+    }
+    return n == 0;
+}
+
+} // namespace platform
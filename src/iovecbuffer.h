@@ -0,0 +1,50 @@
+#ifndef __IOVECBUFFER_H_INCLUDED
+#define __IOVECBUFFER_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/uio.h>
+
+namespace platform {
+
+// Output collected as a list of references to memory regions (e.g. memory
+// mapped template, names of the events), written by writev() without
+// copying. The referenced memory must be valid until the buffer is written.
+class IovecBuffer
+{
+  public:
+    // Append reference to the text, continuous regions are joined
+    void append(std::string_view text);
+    // Insert reference to the text at the position returned by mark()
+    void insert(std::size_t position, std::string_view text);
+
+    // Position for insert(), the next append() starts a new segment
+    std::size_t mark() {
+        join = false;
+        return segments.size();
+    }
+    // Number of bytes
+    std::size_t size() const { return n_bytes; }
+    void clear();
+
+    // Copy of the whole content
+    std::string str() const;
+
+    // Write everything into the file descriptor, throws std::system_error
+    void write(int fd) const;
+    // Create or truncate the file and write, throws std::system_error
+    void write(const std::string &filename) const;
+    // Compare the content with the rest of the file read from the file
+    // descriptor, throws std::system_error
+    bool equals(int fd) const;
+
+  private:
+    std::vector<struct iovec> segments;
+    std::size_t n_bytes = 0;
+    bool join = true;
+};
+
+} // namespace platform
+#endif
@@ -0,0 +1,169 @@
+// Build time generator of the pre-parsed internal SDL mapping database.
+//
+// Parses all entries of s_ControllerMappings (joymapdb.h) with the same
+// ControllerMapping parser used at runtime and writes a header with constexpr
+// ButtonBinding arrays sorted by guid, see joymaptable.h.
+//
+// Usage: joymapgen <output_header>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+#include "logging.h"
+#include "platform.h"
+#include "evdevjoy.h"
+#include "joymapdb.h"
+
+using namespace evdevjoy;
+
+static const char* button_name(ControllerButton button)
+{
+    static const char *names[] = {
+        "INVALID",
+        "BUTTON_A", "BUTTON_B", "BUTTON_X", "BUTTON_Y",
+        "BUTTON_BACK", "BUTTON_GUIDE", "BUTTON_START",
+        "BUTTON_LEFTSTICK", "BUTTON_RIGHTSTICK",
+        "BUTTON_LEFTSHOULDER", "BUTTON_RIGHTSHOULDER",
+        "BUTTON_DPAD_UP", "BUTTON_DPAD_DOWN", "BUTTON_DPAD_LEFT", "BUTTON_DPAD_RIGHT",
+        "BUTTON_MISC1",
+        "BUTTON_PADDLE1", "BUTTON_PADDLE2", "BUTTON_PADDLE3", "BUTTON_PADDLE4",
+        "BUTTON_TOUCHPAD",
+        "BUTTON_MAX",
+        "AXIS_LEFTX", "AXIS_LEFTY", "AXIS_RIGHTX", "AXIS_RIGHTY",
+        "AXIS_TRIGGERLEFT", "AXIS_TRIGGERRIGHT",
+        "AXIS_MAX"
+    };
+    return names[static_cast<int>(button) + 1];
+}
+
+static const char* bind_type_name(BindType bind_type)
+{
+    static const char *names[] = {
+        "BINDTYPE_NONE", "BINDTYPE_BUTTON", "BINDTYPE_AXIS", "BINDTYPE_HAT"
+    };
+    return names[static_cast<int>(bind_type)];
+}
+
+static const char* axis_type_name(ControllerAxisType axis_type)
+{
+    static const char *names[] = {
+        "FULL_AXIS", "HALF_AXIS_POSITIVE", "HALF_AXIS_NEGATIVE"
+    };
+    return names[static_cast<int>(axis_type)];
+}
+
+// Escape string for C++ string literal
+static std::string quote(const std::string &text)
+{
+    std::string result = "\"";
+    for (char c : text) {
+        if ((c == '"') || (c == '\\')) {
+            result += '\\';
+        }
+        result += c;
+    }
+    result += '"';
+    return result;
+}
+
+static void write_binding(std::ostream &os, const ButtonBinding &b)
+{
+    os << "    {BindType::" << bind_type_name(b.input_type)
+        << ", {" << b.input.button
+        << ", " << b.input.axis
+        << ", ControllerAxisType::" << axis_type_name(b.input.axis_type)
+        << ", " << (b.input.invert_input ? "true" : "false")
+        << ", " << b.input.hat
+        << ", " << b.input.hat_mask
+        << "}, BindType::" << bind_type_name(b.output_type)
+        << ", {ControllerButton::" << button_name(b.output.button)
+        << ", ControllerButton::" << button_name(b.output.axis)
+        << ", ControllerAxisType::" << axis_type_name(b.output.axis_type)
+        << "}},\n";
+}
+
+int main(int argc, char *argv[])
+{
+    logging_init();
+
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <output_header>" << std::endl;
+        return 1;
+    }
+
+    // Same rules as SDLJoyMapping::add_sdl_mapping(), later entry of the
+    // same guid replaces the previous one. std::map keeps it sorted by guid.
+    std::map<Guid, ControllerMapping> mapping_db;
+    for (int i=0; s_ControllerMappings[i] != NULL; i++) {
+        ControllerMapping mapping;
+        try {
+            mapping = ControllerMapping(s_ControllerMappings[i], ControllerMapping::PRIORITY_DEFAULT);
+        } catch (const std::runtime_error &e) {
+            // e.g. "xinput" pseudo guid used by SDL on Windows only
+            std::cerr << "joymapgen: skip mapping: " << s_ControllerMappings[i] << std::endl;
+            continue;
+        }
+        if ((mapping.platform != "") && (mapping.platform != platform::get_platform())) {
+            continue;
+        }
+        mapping_db[mapping.guid] = mapping;
+    }
+
+    std::ofstream fout(argv[1], std::ios::out | std::ios::trunc);
+    if (!fout) {
+        std::cerr << "Cannot open output file: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    fout << "// Generated by joymapgen from joymapdb.h, do not edit.\n"
+        << "#ifndef __JOYMAPDB_TABLE_H\n"
+        << "#define __JOYMAPDB_TABLE_H\n\n"
+        << "#include \"joymaptable.h\"\n\n"
+        << "namespace evdevjoy {\n"
+        << "namespace joymapdb {\n\n"
+        << "constexpr ButtonBinding s_Bindings[] = {\n";
+
+    std::size_t n_bindings = 0;
+    for (auto const &item : mapping_db) {
+        fout << "    // " << item.first << "\n";
+        item.second.button_binding.for_each([&fout](const ButtonBinding &binding) {
+            write_binding(fout, binding);
+        });
+        n_bindings += item.second.button_binding.size();
+    }
+    if (n_bindings == 0) {
+        fout << "    {},\n";
+    }
+    fout << "};\n\n"
+        << "constexpr CompiledMapping s_Mappings[] = {\n";
+
+    std::size_t first_binding = 0;
+    for (auto const &item : mapping_db) {
+        std::size_t binding_count = item.second.button_binding.size();
+        fout << "    {Guid(0x" << std::hex << std::setw(16) << std::setfill('0') << item.first.hi
+            << "ULL, 0x" << std::setw(16) << item.first.lo << "ULL)" << std::dec << std::setfill(' ')
+            << ", " << quote(item.second.name)
+            << ", " << first_binding
+            << ", " << binding_count
+            << "},\n";
+        first_binding += binding_count;
+    }
+
+    fout << "};\n\n"
+        << "} // namespace joymapdb\n"
+        << "} // namespace evdevjoy\n"
+        << "#endif\n";
+
+    fout.close();
+    if (!fout) {
+        std::cerr << "Error during writing output file: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "joymapgen: " << mapping_db.size() << " mappings, "
+        << n_bindings << " bindings" << std::endl;
+    return 0;
+}
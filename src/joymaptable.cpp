@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <iterator>
+
+#include "joymaptable.h"
+#include "joymapdb_table.h"
+
+namespace evdevjoy {
+
+const CompiledMapping* find_internal_mapping(Guid const &guid)
+{
+    const CompiledMapping *first = std::begin(joymapdb::s_Mappings);
+    const CompiledMapping *last = std::end(joymapdb::s_Mappings);
+
+    const CompiledMapping *it = std::lower_bound(first, last, guid,
+        [](const CompiledMapping &item, const Guid &key) {
+            return item.guid < key;
+        });
+
+    if ((it != last) && (it->guid == guid)) {
+        return it;
+    }
+    return nullptr;
+}
+
+const ButtonBinding* internal_mapping_bindings(const CompiledMapping &mapping)
+{
+    return &joymapdb::s_Bindings[mapping.first_binding];
+}
+
+std::size_t internal_mapping_count()
+{
+    return std::size(joymapdb::s_Mappings);
+}
+
+const CompiledMapping& internal_mapping(std::size_t i)
+{
+    return joymapdb::s_Mappings[i];
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,36 @@
+#ifndef __JOYMAPTABLE_H
+#define __JOYMAPTABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include "evdevjoy.h"
+#include "guid.h"
+
+namespace evdevjoy {
+
+// Pre-parsed entry of the internal SDL mapping database. The table is
+// generated at build time by joymapgen from joymapdb.h, entries are sorted
+// by guid and the bindings of an entry are stored in the shared array
+// joymapdb::s_Bindings[first_binding ... first_binding+binding_count).
+struct CompiledMapping
+{
+    Guid guid;
+    std::string_view name;
+    uint16_t first_binding;
+    uint16_t binding_count;
+};
+
+// Binary search in the generated table, returns nullptr when the guid is
+// not part of the internal database. No parsing, no heap allocation.
+const CompiledMapping* find_internal_mapping(Guid const &guid);
+
+// Bindings of the compiled mapping entry
+const ButtonBinding* internal_mapping_bindings(const CompiledMapping &mapping);
+
+// Number of entries in the internal database
+std::size_t internal_mapping_count();
+// The i-th entry, entries are sorted by guid
+const CompiledMapping& internal_mapping(std::size_t i);
+
+} // namespace evdevjoy
+#endif
@@ -26,6 +26,11 @@ void logging_init() {
     defaultConf.set(el::Level::Warning, 
         el::ConfigurationType::ToStandardOutput, "true");
 
+    // Info and debug messages are written only into the log file (option
+    // --log), disabled levels are not formatted at all
+    defaultConf.set(el::Level::Info, el::ConfigurationType::Enabled, "false");
+    defaultConf.set(el::Level::Debug, el::ConfigurationType::Enabled, "false");
+
 /*
     defaultConf.setGlobally(
             el::ConfigurationType::ToFile, "true");
@@ -45,5 +50,7 @@ void logging_to_file(const std::string &logfile)
     el::Configurations c;
     
     c.setGlobally(el::ConfigurationType::Filename, logfile);
+    c.set(el::Level::Info, el::ConfigurationType::Enabled, "true");
+    c.set(el::Level::Debug, el::ConfigurationType::Enabled, "true");
     el::Loggers::setDefaultConfigurations(c, true);
 }
\ No newline at end of file
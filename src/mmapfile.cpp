@@ -0,0 +1,75 @@
+#include <cerrno>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mmapfile.h"
+
+namespace platform {
+
+MappedFile::MappedFile(const std::string &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), 
+            "Cannot open file '" + filename + "'");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), 
+            "Cannot stat file '" + filename + "'");
+    }
+
+    length = static_cast<std::size_t>(st.st_size);
+    if (length > 0) {
+        addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            addr = nullptr;
+            length = 0;
+            close(fd);
+            throw std::system_error(err, std::generic_category(), 
+                "Cannot map file '" + filename + "'");
+        }
+    }
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept :
+    addr(std::exchange(other.addr, nullptr)),
+    length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        addr = std::exchange(other.addr, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+void MappedFile::release()
+{
+    if (addr != nullptr) {
+        munmap(addr, length);
+        addr = nullptr;
+        length = 0;
+    }
+}
+
+} // namespace platform
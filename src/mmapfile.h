@@ -0,0 +1,39 @@
+#ifndef __MMAPFILE_H_INCLUDED
+#define __MMAPFILE_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace platform {
+
+// Read only memory mapped file. The mapping is released in the destructor,
+// all pointers and views into the data are valid until then.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    // Throws std::system_error when the file cannot be opened or mapped
+    explicit MappedFile(const std::string &filename);
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile& operator=(MappedFile &&other) noexcept;
+    ~MappedFile();
+
+    const char* data() const { return static_cast<const char*>(addr); }
+    std::size_t size() const { return length; }
+    std::string_view view() const { return std::string_view(data(), length); }
+    bool empty() const { return length == 0; }
+
+  private:
+    void *addr = nullptr;
+    std::size_t length = 0;
+
+    void release();
+
+    // Disable copy constructor and assign operator
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+} // namespace platform
+#endif
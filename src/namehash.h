@@ -0,0 +1,136 @@
+#ifndef __NAMEHASH_H
+#define __NAMEHASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace evdevjoy {
+
+// Compile time perfect hash of short lowercase names (button and axis
+// aliases). The seed of the hash is searched by the constexpr constructor so
+// that every name has its own slot, the lookup is one hash, one table load
+// and one comparison. Lookup is case insensitive (ASCII), no temporary
+// lowercase copy of the name is needed.
+
+// FNV-1a over the characters with the 0x20 bit set: ASCII letters are folded
+// to lowercase, digits are not changed. Other characters can change ('_'
+// becomes 0x7f), the names of the table and the searched name are folded
+// the same way.
+constexpr uint32_t name_hash(std::string_view name, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (std::size_t i=0; i < name.size(); i++) {
+        h ^= static_cast<uint8_t>(name[i]) | 0x20;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+constexpr char ascii_lower(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Compare the name with the lowercase key ignoring the case of the name
+constexpr bool iequals_lower(std::string_view name, std::string_view lower_key)
+{
+    if (name.size() != lower_key.size()) {
+        return false;
+    }
+    for (std::size_t i=0; i < name.size(); i++) {
+        if (ascii_lower(name[i]) != lower_key[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Value>
+struct NameEntry
+{
+    std::string_view name;    // lowercase
+    Value value{};
+};
+
+template <typename Value, std::size_t N, std::size_t SLOTS = 256>
+class NameHashMap
+{
+  public:
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be power of two");
+    static_assert(N < SLOTS / 2, "Too many names for the number of slots");
+    static_assert(N < 0xff, "Too many names for uint8_t index");
+
+    constexpr NameHashMap(const NameEntry<Value> (&entries)[N])
+    {
+        for (std::size_t i=0; i < N; i++) {
+            for (std::size_t j=0; j < entries[i].name.size(); j++) {
+                if (ascii_lower(entries[i].name[j]) != entries[i].name[j]) {
+                    throw std::logic_error("NameHashMap: name must be lowercase");
+                }
+            }
+            for (std::size_t j=0; j < i; j++) {
+                if (entries[i].name == entries[j].name) {
+                    throw std::logic_error("NameHashMap: duplicate name");
+                }
+            }
+            this->entries[i] = entries[i];
+        }
+        for (uint32_t s=1; s < MAX_SEED; s++) {
+            if (try_seed(s)) {
+                seed = s;
+                return;
+            }
+        }
+        throw std::logic_error("NameHashMap: no perfect hash seed found");
+    }
+
+    // Returns nullptr when the name is not in the table
+    constexpr const Value* find(std::string_view name) const
+    {
+        uint8_t index = slots[name_hash(name, seed) & (SLOTS - 1)];
+        if ((index == EMPTY) || !iequals_lower(name, entries[index].name)) {
+            return nullptr;
+        }
+        return &entries[index].value;
+    }
+
+    constexpr std::size_t size() const { return N; }
+    constexpr const NameEntry<Value>* begin() const { return entries.data(); }
+    constexpr const NameEntry<Value>* end() const { return entries.data() + N; }
+
+  private:
+    static const uint8_t EMPTY = 0xff;
+    static const uint32_t MAX_SEED = 10000;
+
+    constexpr bool try_seed(uint32_t s)
+    {
+        for (std::size_t i=0; i < SLOTS; i++) {
+            slots[i] = EMPTY;
+        }
+        for (std::size_t i=0; i < N; i++) {
+            uint8_t &slot = slots[name_hash(entries[i].name, s) & (SLOTS - 1)];
+            if (slot != EMPTY) {
+                return false;
+            }
+            slot = static_cast<uint8_t>(i);
+        }
+        return true;
+    }
+
+    std::array<NameEntry<Value>, N> entries{};
+    std::array<uint8_t, SLOTS> slots{};
+    uint32_t seed = 0;
+};
+
+// Deduces the number of names: make_name_map<Value>({{"name", value}, ...})
+template <typename Value, std::size_t SLOTS = 256, std::size_t N>
+constexpr NameHashMap<Value, N, SLOTS> make_name_map(const NameEntry<Value> (&entries)[N])
+{
+    return NameHashMap<Value, N, SLOTS>(entries);
+}
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,206 @@
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "outputfile.h"
+
+namespace platform {
+
+static std::system_error file_error(const std::string &message, const std::string &filename)
+{
+    return std::system_error(errno, std::generic_category(), message + " '" + filename + "'");
+}
+
+// Read up to size bytes, less only at the end of the file
+static std::size_t read_full(int fd, char *buffer, std::size_t size)
+{
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, buffer + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "Cannot read file");
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+static bool same_content(int fd_a, int fd_b)
+{
+    char buffer_a[16384];
+    char buffer_b[16384];
+    while (true) {
+        std::size_t n_a = read_full(fd_a, buffer_a, sizeof(buffer_a));
+        std::size_t n_b = read_full(fd_b, buffer_b, sizeof(buffer_b));
+        if ((n_a != n_b) || (std::memcmp(buffer_a, buffer_b, n_a) != 0)) {
+            return false;
+        }
+        if (n_a < sizeof(buffer_a)) {
+            return true;
+        }
+    }
+}
+
+static void copy_content(int fd_in, int fd_out)
+{
+    bool use_copy_range = true;
+    char buffer[16384];
+    while (true) {
+        ssize_t n;
+        if (use_copy_range) {
+            n = copy_file_range(fd_in, nullptr, fd_out, nullptr, 1 << 30, 0);
+            if ((n < 0) && ((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) ||
+                    (errno == EOPNOTSUPP)))
+            {
+                use_copy_range = false;
+                continue;
+            }
+        } else {
+            n = read(fd_in, buffer, sizeof(buffer));
+            for (ssize_t done = 0; (n > 0) && (done < n); ) {
+                ssize_t written = write(fd_out, buffer + done, n - done);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error(errno, std::generic_category(), "Cannot write file");
+                }
+                done += written;
+            }
+        }
+        if (n == 0) {
+            return;
+        }
+        if ((n < 0) && (errno != EINTR)) {
+            throw std::system_error(errno, std::generic_category(), "Cannot copy file");
+        }
+    }
+}
+
+// Temporary file next to the target, removed unless commit() renames it
+class TempFile
+{
+  public:
+    explicit TempFile(const std::string &target) : target(target) {
+        static std::atomic<unsigned> counter{0};
+        std::size_t i_name = target.rfind('/') + 1;
+        filename = target.substr(0, i_name) + "." + target.substr(i_name) + ".tmp"
+            + std::to_string(getpid()) + "-" + std::to_string(counter++);
+        fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0) {
+            throw file_error("Cannot create file", filename);
+        }
+    }
+
+    ~TempFile() {
+        if (fd >= 0) {
+            close(fd);
+            unlink(filename.c_str());
+        }
+    }
+
+    int get_fd() const { return fd; }
+
+    // Rename over the target, mode of the replaced file is kept
+    void commit(const struct stat *old_stat) {
+        if (old_stat) {
+            fchmod(fd, old_stat->st_mode & 07777);
+        }
+        int result = close(fd);
+        fd = -1;
+        if ((result < 0) || (rename(filename.c_str(), target.c_str()) < 0)) {
+            std::system_error error = file_error("Cannot write file", target);
+            unlink(filename.c_str());
+            throw error;
+        }
+    }
+
+  private:
+    std::string target;
+    std::string filename;
+    int fd = -1;
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+};
+
+// Compare the existing file by compare(fd) and replace it by write(fd) when
+// different
+template <typename Compare, typename Write>
+static FileUpdate update(const std::string &filename, std::size_t size,
+    Compare compare, Write write)
+{
+    struct stat old_stat;
+    bool has_stat = false;
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) && (errno != ENOENT)) {
+        throw file_error("Cannot open file", filename);
+    }
+    bool exists = (fd >= 0);
+    if (exists) {
+        bool same = false;
+        has_stat = (fstat(fd, &old_stat) == 0);
+        try {
+            same = has_stat && (static_cast<std::size_t>(old_stat.st_size) == size) && compare(fd);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        if (same) {
+            return FileUpdate::UNCHANGED;
+        }
+    }
+
+    TempFile tmp(filename);
+    write(tmp.get_fd());
+    tmp.commit(has_stat ? &old_stat : nullptr);
+    return exists ? FileUpdate::REWRITTEN : FileUpdate::CREATED;
+}
+
+FileUpdate update_file(const std::string &filename, const IovecBuffer &content)
+{
+    return update(filename, content.size(),
+        [&](int fd) { return content.equals(fd); },
+        [&](int fd) { content.write(fd); });
+}
+
+FileUpdate update_file_from(const std::string &filename, const std::string &source)
+{
+    int fd_source = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat source_stat;
+    if ((fd_source < 0) || (fstat(fd_source, &source_stat) < 0)) {
+        std::system_error error = file_error("Cannot open file", source);
+        if (fd_source >= 0) {
+            close(fd_source);
+        }
+        throw error;
+    }
+
+    try {
+        FileUpdate result = update(filename, source_stat.st_size,
+            [&](int fd) { return same_content(fd, fd_source); },
+            [&](int fd) {
+                // The source was read by the comparison
+                lseek(fd_source, 0, SEEK_SET);
+                copy_content(fd_source, fd);
+            });
+        close(fd_source);
+        return result;
+    } catch (...) {
+        close(fd_source);
+        throw;
+    }
+}
+
+} // namespace platform
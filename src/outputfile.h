@@ -0,0 +1,28 @@
+#ifndef __OUTPUTFILE_H_INCLUDED
+#define __OUTPUTFILE_H_INCLUDED
+
+#include <string>
+#include "iovecbuffer.h"
+
+namespace platform {
+
+enum class FileUpdate
+{
+    UNCHANGED,      // same content, the file was not touched
+    REWRITTEN,
+    CREATED
+};
+
+// Write the content only when it differs from the file. The content is
+// written into a temporary file in the same directory and renamed over the
+// file, readers see the old or the new file, never a partial one. Unchanged
+// file keeps its modification time, rewritten file keeps its mode.
+// Throws std::system_error.
+FileUpdate update_file(const std::string &filename, const IovecBuffer &content);
+
+// The same with the content of the source file, copied in the kernel by
+// copy_file_range() (read/write fallback)
+FileUpdate update_file_from(const std::string &filename, const std::string &source);
+
+} // namespace platform
+#endif
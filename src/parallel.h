@@ -0,0 +1,211 @@
+#ifndef __PARALLEL_H_INCLUDED
+#define __PARALLEL_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Number of hardware threads, at least 1
+    inline unsigned default_jobs() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Indexes [begin, end) owned by one worker. Both bounds are packed into
+    // one atomic word, the owner takes indexes from the begin, a thief takes
+    // the upper half, both by compare and swap.
+    class alignas(64) StealingRange
+    {
+      public:
+        void reset(std::size_t begin, std::size_t end) {
+            range.store(pack(begin, end), std::memory_order_release);
+        }
+
+        bool pop(std::size_t &i) {
+            uint64_t value = range.load(std::memory_order_acquire);
+            while (begin_of(value) < end_of(value)) {
+                if (range.compare_exchange_weak(value, pack(begin_of(value) + 1, end_of(value)),
+                        std::memory_order_acq_rel)) 
+                {
+                    i = begin_of(value);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool steal(std::size_t &begin, std::size_t &end) {
+            uint64_t value = range.load(std::memory_order_acquire);
+            while (begin_of(value) < end_of(value)) {
+                std::size_t middle = begin_of(value) + (end_of(value) - begin_of(value)) / 2;
+                if (range.compare_exchange_weak(value, pack(begin_of(value), middle),
+                        std::memory_order_acq_rel)) 
+                {
+                    begin = middle;
+                    end = end_of(value);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+      private:
+        std::atomic<uint64_t> range{0};
+
+        static uint64_t pack(std::size_t begin, std::size_t end) {
+            return (static_cast<uint64_t>(begin) << 32) | static_cast<uint32_t>(end);
+        }
+        static std::size_t begin_of(uint64_t value) { return static_cast<std::size_t>(value >> 32); }
+        static std::size_t end_of(uint64_t value) { return static_cast<std::size_t>(value & 0xffffffffu); }
+    };
+
+    // Bounded lock-free queue of one producer and one consumer thread. The
+    // capacity is rounded up to a power of two, the items are written and
+    // read in place: begin_push() / end_push() by the producer, front() /
+    // pop() by the consumer. Head and tail are on separate cache lines, each
+    // side caches the index of the other side and loads it only when the
+    // queue looks full (empty).
+    template <typename T>
+    class SpscRing
+    {
+      public:
+        explicit SpscRing(std::size_t min_capacity) {
+            std::size_t capacity = 1;
+            while (capacity < std::max<std::size_t>(min_capacity, 2)) {
+                capacity *= 2;
+            }
+            items.reset(new T[capacity]);
+            mask = capacity - 1;
+        }
+
+        // Producer: free item or nullptr when the queue is full
+        T* begin_push() {
+            std::size_t t = tail.load(std::memory_order_relaxed);
+            if (t - cached_head > mask) {
+                cached_head = head.load(std::memory_order_acquire);
+                if (t - cached_head > mask) {
+                    return nullptr;
+                }
+            }
+            return &items[t & mask];
+        }
+        // Producer: publish the item returned by begin_push()
+        void end_push() {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Consumer: the oldest item or nullptr when the queue is empty
+        T* front() {
+            std::size_t h = head.load(std::memory_order_relaxed);
+            if (h == cached_tail) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (h == cached_tail) {
+                    return nullptr;
+                }
+            }
+            return &items[h & mask];
+        }
+        // Consumer: release the item returned by front()
+        void pop() {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Number of items, approximate when called from other thread
+        std::size_t size() const {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+        std::size_t capacity() const { return mask + 1; }
+
+      private:
+        std::unique_ptr<T[]> items;
+        std::size_t mask = 0;
+        // Consumer side
+        alignas(64) std::atomic<std::size_t> head{0};
+        std::size_t cached_tail = 0;
+        // Producer side
+        alignas(64) std::atomic<std::size_t> tail{0};
+        std::size_t cached_head = 0;
+    };
+
+    // Call fn(i) for i in [0, count) on up to jobs threads (0 = default_jobs()).
+    // Every worker gets a contiguous block of the indexes, the worker which
+    // finished its block steals half of the remaining indexes of other
+    // worker (work stealing). The calling thread is one of the workers. The
+    // first exception thrown by fn is rethrown after all workers have
+    // finished.
+    template <typename Fn>
+    void for_each_index(std::size_t count, unsigned jobs, Fn fn)
+    {
+        if (jobs == 0) {
+            jobs = default_jobs();
+        }
+        std::size_t n_workers = std::min<std::size_t>(jobs, count);
+        if (n_workers <= 1) {
+            for (std::size_t i=0; i < count; i++) {
+                fn(i);
+            }
+            return;
+        }
+        if (count > UINT32_MAX) {
+            throw std::length_error("parallel::for_each_index: too many indexes");
+        }
+
+        std::unique_ptr<StealingRange[]> ranges(new StealingRange[n_workers]);
+        for (std::size_t w=0; w < n_workers; w++) {
+            ranges[w].reset(count * w / n_workers, count * (w + 1) / n_workers);
+        }
+
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto worker = [&](std::size_t w) {
+            std::size_t i, begin, end;
+            while (true) {
+                while (ranges[w].pop(i)) {
+                    try {
+                        fn(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+
+                // Nothing left when no other worker has indexes to steal
+                bool stolen = false;
+                for (std::size_t v=1; (v < n_workers) && !stolen; v++) {
+                    stolen = ranges[(w + v) % n_workers].steal(begin, end);
+                }
+                if (!stolen) {
+                    return;
+                }
+                ranges[w].reset(begin, end);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(n_workers - 1);
+        for (std::size_t w=1; w < n_workers; w++) {
+            threads.emplace_back(worker, w);
+        }
+        worker(0);
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+} // namespace parallel
+
+#endif
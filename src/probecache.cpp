@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "probecache.h"
+#include "outputfile.h"
+#include "stringext.h"
+
+namespace evdevjoy {
+
+static const char *CACHE_HEADER = "# sdlxboxmap probe cache 1";
+static const std::size_t N_FIELDS = 8;
+
+static bool parse_id(std::string_view text, uint16_t &id)
+{
+    auto result = std::from_chars(text.data(), text.data() + text.size(), id, 16);
+    return (result.ec == std::errc()) && (result.ptr == text.data() + text.size());
+}
+
+static std::string format_id(uint16_t id)
+{
+    char buffer[8];
+    std::snprintf(buffer, sizeof(buffer), "%04x", id);
+    return buffer;
+}
+
+ProbeCache::ProbeCache(std::string filename)
+    : filename(std::move(filename))
+{
+}
+
+void ProbeCache::load()
+{
+    entries.clear();
+    modified = false;
+
+    std::ifstream fin(filename);
+    if (!fin) {
+        LOG(INFO) << "ProbeCache: new cache " << filename;
+        return;
+    }
+
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(fin, line)) {
+        line_number++;
+        if (line.empty() || (line[0] == '#')) {
+            continue;
+        }
+        if (!parse_line(line)) {
+            LOG(WARNING) << "ProbeCache: skip wrong line " << line_number << " in " << filename;
+        }
+    }
+    LOG(INFO) << "ProbeCache: " << entries.size() << " devices loaded from " << filename;
+}
+
+bool ProbeCache::parse_line(std::string_view line)
+{
+    std::vector<std::string_view> fields = string::split(line, "\t", N_FIELDS - 1);
+    if (fields.size() != N_FIELDS) {
+        return false;
+    }
+
+    Guid guid;
+    Entry entry;
+    DeviceDescriptor &descriptor = entry.descriptor;
+    if (!Guid::from_string(fields[0], guid) ||
+        !parse_id(fields[1], descriptor.bustype) ||
+        !parse_id(fields[2], descriptor.vendor) ||
+        !parse_id(fields[3], descriptor.product) ||
+        !parse_id(fields[4], descriptor.version) ||
+        !SysfsInput::parse_bitmap(fields[5], descriptor.key_bits) ||
+        !SysfsInput::parse_bitmap(fields[6], descriptor.abs_bits))
+    {
+        return false;
+    }
+    // Key is the guid computed from the ids
+    if (descriptor.get_guid() != guid) {
+        return false;
+    }
+    entry.key_caps = fields[5];
+    entry.abs_caps = fields[6];
+    descriptor.name = fields[7];
+    entries.emplace(guid, std::move(entry));
+    return true;
+}
+
+// Written by platform::update_file(), the concurrent runs (udev) write
+// their own temporary files and rename them, the cache is never mixed
+void ProbeCache::save() const
+{
+    std::ostringstream content;
+    content << CACHE_HEADER << '\n';
+    for (auto const &item : entries) {
+        const DeviceDescriptor &descriptor = item.second.descriptor;
+        content << item.first << '\t'
+            << format_id(descriptor.bustype) << '\t'
+            << format_id(descriptor.vendor) << '\t'
+            << format_id(descriptor.product) << '\t'
+            << format_id(descriptor.version) << '\t'
+            << item.second.key_caps << '\t'
+            << item.second.abs_caps << '\t'
+            << descriptor.name << '\n';
+    }
+    std::string text = content.str();
+    platform::IovecBuffer buffer;
+    buffer.append(text);
+    platform::update_file(filename, buffer);
+}
+
+bool ProbeCache::find(const SysfsInput &sysfs, const std::string &devname,
+        DeviceDescriptor &descriptor) const
+{
+    std::string event_name = SysfsInput::get_event_name(devname);
+    if (event_name.empty()) {
+        return false;
+    }
+
+    DeviceDescriptor identity;
+    std::string key_caps, abs_caps;
+    if (!sysfs.read_identity(event_name, identity, key_caps, abs_caps)) {
+        return false;
+    }
+
+    auto range = entries.equal_range(identity.get_guid());
+    for (auto it = range.first; it != range.second; ++it) {
+        const Entry &entry = it->second;
+        if ((entry.descriptor.name == identity.name) &&
+            (entry.key_caps == key_caps) && (entry.abs_caps == abs_caps))
+        {
+            descriptor = entry.descriptor;
+            descriptor.devname = devname;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProbeCache::insert(const DeviceDescriptor &descriptor)
+{
+    Entry entry;
+    entry.key_caps = SysfsInput::format_bitmap(descriptor.key_bits);
+    entry.abs_caps = SysfsInput::format_bitmap(descriptor.abs_bits);
+    entry.descriptor = descriptor;
+    entry.descriptor.devname.clear();
+    // Tab and new line are separators of the cache file
+    std::replace_if(entry.descriptor.name.begin(), entry.descriptor.name.end(),
+        [](char c) { return (c == '\t') || (c == '\n'); }, ' ');
+
+    Guid guid = descriptor.get_guid();
+    auto range = entries.equal_range(guid);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.descriptor.name == entry.descriptor.name) {
+            if ((it->second.key_caps == entry.key_caps) && (it->second.abs_caps == entry.abs_caps)) {
+                return;
+            }
+            entries.erase(it);
+            break;
+        }
+    }
+    entries.emplace(guid, std::move(entry));
+    modified = true;
+}
+
+} // namespace evdevjoy
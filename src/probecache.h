@@ -0,0 +1,56 @@
+#ifndef __PROBECACHE_H
+#define __PROBECACHE_H
+
+#include <string>
+#include <unordered_map>
+#include "evdevjoy.h"
+#include "sysfsinput.h"
+
+namespace evdevjoy {
+
+// Persistent cache of the device descriptors probed by libevdev, option
+// --probe-cache. The entry is keyed by the guid, it is valid for the device
+// when the name and the EV_KEY/EV_ABS capability strings in sysfs are the
+// same as when the device was probed. Validation reads a few sysfs
+// attributes, the device is not opened.
+//
+// Text file, one device per line, tab separated:
+//   <guid> <bustype> <vendor> <product> <version> <key caps> <abs caps> <name>
+class ProbeCache
+{
+  public:
+    explicit ProbeCache(std::string filename);
+
+    // Missing file is an empty cache, wrong lines are skipped
+    void load();
+    // Written into unique temporary file and renamed, throws
+    // std::system_error
+    void save() const;
+
+    // Cached descriptor of the device node (or by-path link) when its sysfs
+    // identity is the same, descriptor.devname is set to devname
+    bool find(const SysfsInput &sysfs, const std::string &devname,
+        DeviceDescriptor &descriptor) const;
+    // Add the probed device, replaces the entry of the same guid and name
+    void insert(const DeviceDescriptor &descriptor);
+
+    bool is_modified() const { return modified; }
+    std::size_t size() const { return entries.size(); }
+
+  protected:
+    struct Entry
+    {
+        std::string key_caps;       // sysfs format, see SysfsInput::format_bitmap()
+        std::string abs_caps;
+        DeviceDescriptor descriptor;
+    };
+
+    std::string filename;
+    std::unordered_multimap<Guid, Entry, GuidHash> entries;
+    bool modified = false;
+
+    bool parse_line(std::string_view line);
+};
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <ostream>
+#include <system_error>
+#include <libevdev/libevdev-uinput.h>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "remapengine.h"
+
+namespace evdevjoy {
+
+//////////////////////////////////////////////////////////////////////////
+// StreamSink
+//////////////////////////////////////////////////////////////////////////
+
+void StreamSink::write(const ControllerEvent &event)
+{
+    os << event.gamepad << ' ' << get_button_name(event.button) << ' ' << event.value << '\n';
+}
+
+void StreamSink::sync(std::size_t /*gamepad*/)
+{
+    os.flush();
+}
+
+void StreamSink::remove_gamepad(std::size_t gamepad)
+{
+    os << gamepad << " removed" << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UinputSink
+//////////////////////////////////////////////////////////////////////////
+
+// Code of the virtual gamepad by ControllerButton (xpad driver), 0 for the
+// button which is not emitted, d-pad is the hat
+static const unsigned int s_UinputCodes[] = {
+    BTN_SOUTH, BTN_EAST, BTN_NORTH, BTN_WEST,       // a, b, x, y
+    BTN_SELECT, BTN_MODE, BTN_START,                // back, guide, start
+    BTN_THUMBL, BTN_THUMBR, BTN_TL, BTN_TR,         // sticks, shoulders
+    0, 0, 0, 0,                                     // d-pad
+    KEY_RECORD,                                     // misc1
+    BTN_TRIGGER_HAPPY5, BTN_TRIGGER_HAPPY6,         // paddles
+    BTN_TRIGGER_HAPPY7, BTN_TRIGGER_HAPPY8,
+    0,                                              // touchpad
+    0,                                              // BUTTON_MAX
+    ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ     // axes
+};
+static_assert(sizeof(s_UinputCodes) / sizeof(s_UinputCodes[0]) ==
+    static_cast<std::size_t>(ControllerButton::AXIS_MAX), "s_UinputCodes does not match ControllerButton");
+
+static unsigned int get_uinput_code(ControllerButton button)
+{
+    return s_UinputCodes[static_cast<std::size_t>(button)];
+}
+
+UinputSink::~UinputSink()
+{
+    for (auto &device : devices) {
+        if (device.uinput != nullptr) {
+            libevdev_uinput_destroy(device.uinput);
+        }
+    }
+}
+
+void UinputSink::add_gamepad(std::size_t gamepad, const EvdevJoystick &joystick)
+{
+    struct libevdev *evdev = libevdev_new();
+    std::string name = "sdlxboxmap " + std::string(joystick.get_name());
+    libevdev_set_name(evdev, name.c_str());
+    libevdev_enable_event_type(evdev, EV_KEY);
+    libevdev_enable_event_type(evdev, EV_ABS);
+    for (int i=0; i < static_cast<int>(ControllerButton::AXIS_MAX); i++) {
+        ControllerButton button = static_cast<ControllerButton>(i);
+        unsigned int code = get_uinput_code(button);
+        if (code == 0) {
+            continue;
+        }
+        if (button < ControllerButton::BUTTON_MAX) {
+            libevdev_enable_event_code(evdev, EV_KEY, code, nullptr);
+        } else {
+            struct input_absinfo absinfo = {};
+            bool is_trigger = (button == ControllerButton::AXIS_TRIGGERLEFT) ||
+                (button == ControllerButton::AXIS_TRIGGERRIGHT);
+            absinfo.minimum = is_trigger ? 0 : RemapTable::AXIS_MIN;
+            absinfo.maximum = RemapTable::AXIS_MAX;
+            libevdev_enable_event_code(evdev, EV_ABS, code, &absinfo);
+        }
+    }
+    for (unsigned int code : {ABS_HAT0X, ABS_HAT0Y}) {
+        struct input_absinfo absinfo = {};
+        absinfo.minimum = -1;
+        absinfo.maximum = 1;
+        libevdev_enable_event_code(evdev, EV_ABS, code, &absinfo);
+    }
+
+    if (devices.size() <= gamepad) {
+        devices.resize(gamepad + 1);
+    }
+    int rc = libevdev_uinput_create_from_device(evdev, LIBEVDEV_UINPUT_OPEN_MANAGED,
+        &devices[gamepad].uinput);
+    libevdev_free(evdev);
+    if (rc < 0) {
+        devices[gamepad].uinput = nullptr;
+        throw std::system_error(-rc, std::generic_category(), "Cannot create uinput device");
+    }
+    const char *devnode = libevdev_uinput_get_devnode(devices[gamepad].uinput);
+    LOG(INFO) << "UinputSink: gamepad " << gamepad << " -> " << (devnode ? devnode : "?");
+}
+
+void UinputSink::write(const ControllerEvent &event)
+{
+    Device &device = devices[event.gamepad];
+    if (device.uinput == nullptr) {
+        return;
+    }
+    if ((event.button >= ControllerButton::BUTTON_DPAD_UP) &&
+        (event.button <= ControllerButton::BUTTON_DPAD_RIGHT))
+    {
+        int *dpad = device.dpad;
+        dpad[static_cast<int>(event.button) - static_cast<int>(ControllerButton::BUTTON_DPAD_UP)] = event.value;
+        bool is_y = (event.button <= ControllerButton::BUTTON_DPAD_DOWN);
+        libevdev_uinput_write_event(device.uinput, EV_ABS, is_y ? ABS_HAT0Y : ABS_HAT0X,
+            is_y ? (dpad[1] - dpad[0]) : (dpad[3] - dpad[2]));
+        return;
+    }
+    unsigned int code = get_uinput_code(event.button);
+    if (code != 0) {
+        libevdev_uinput_write_event(device.uinput,
+            (event.type == ControllerEvent::Type::AXIS) ? EV_ABS : EV_KEY, code, event.value);
+    }
+}
+
+void UinputSink::sync(std::size_t gamepad)
+{
+    if (devices[gamepad].uinput != nullptr) {
+        libevdev_uinput_write_event(devices[gamepad].uinput, EV_SYN, SYN_REPORT, 0);
+    }
+}
+
+void UinputSink::remove_gamepad(std::size_t gamepad)
+{
+    Device &device = devices[gamepad];
+    if (device.uinput != nullptr) {
+        libevdev_uinput_destroy(device.uinput);
+        device.uinput = nullptr;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// LatencyStats
+//////////////////////////////////////////////////////////////////////////
+
+// Bucket 4*e + m: 2^e <= ns < 2^(e+1), m is the next two bits
+static int latency_bucket(int64_t ns)
+{
+    if (ns < 4) {
+        return static_cast<int>(std::max<int64_t>(ns, 0));
+    }
+    int e = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+    int m = static_cast<int>((ns >> (e - 2)) & 3);
+    return 4 * e + m;
+}
+
+static int64_t bucket_upper_bound(int bucket)
+{
+    if (bucket < 4) {
+        return bucket;
+    }
+    int e = bucket / 4;
+    int m = bucket % 4;
+    return ((int64_t(4 + m + 1)) << (e - 2)) - 1;
+}
+
+void LatencyStats::add(int64_t ns)
+{
+    ns = std::max<int64_t>(ns, 0);
+    buckets[latency_bucket(ns)]++;
+    count++;
+    sum += ns;
+    max = std::max(max, ns);
+}
+
+int64_t LatencyStats::get_percentile(double percentile) const
+{
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * count));
+    uint64_t seen = 0;
+    for (int i=0; i < N_BUCKETS; i++) {
+        seen += buckets[i];
+        if ((seen >= rank) && (seen > 0)) {
+            return std::min(bucket_upper_bound(i), max);
+        }
+    }
+    return max;
+}
+
+void LatencyStats::print(std::ostream &os) const
+{
+    os << "Latency of " << count << " events: mean " << get_mean() / 1000.0 << " us, "
+        << "p50 " << get_percentile(50) / 1000.0 << " us, "
+        << "p99 " << get_percentile(99) / 1000.0 << " us, "
+        << "max " << max / 1000.0 << " us" << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// RemapEngine
+//////////////////////////////////////////////////////////////////////////
+
+std::size_t RemapEngine::add(const EvdevJoystick &gamepad)
+{
+    std::size_t index = gamepads.size();
+    gamepads.push_back(Gamepad{RemapTable(gamepad)});
+    sink.add_gamepad(index, gamepad);
+    return index;
+}
+
+void RemapEngine::on_event(std::size_t index, const struct input_event &ev)
+{
+    on_frame(index, &ev, 1);
+}
+
+void RemapEngine::on_frame(std::size_t index, const struct input_event *events, std::size_t count)
+{
+    Gamepad &gamepad = gamepads[index];
+    // Time of the written events, the latency is measured once at the end
+    written_times.clear();
+    for (std::size_t i=0; i < count; i++) {
+        const struct input_event &ev = events[i];
+        if (ev.type == EV_SYN) {
+            if ((ev.code == SYN_REPORT) && gamepad.changed) {
+                sink.sync(index);
+                gamepad.changed = false;
+            }
+            continue;
+        }
+
+        int64_t time = int64_t(ev.input_event_sec) * 1000000000 + int64_t(ev.input_event_usec) * 1000;
+        gamepad.table.translate(ev, [&](ControllerButton output, bool is_axis, int value) {
+            int &last = gamepad.values[static_cast<std::size_t>(output)];
+            if (value == last) {
+                return;
+            }
+            last = value;
+            sink.write(ControllerEvent{
+                is_axis ? ControllerEvent::Type::AXIS : ControllerEvent::Type::BUTTON,
+                index, output, value, time});
+            gamepad.changed = true;
+            written_times.push_back(time);
+        });
+    }
+
+    if (!written_times.empty()) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t now_ns = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+        for (int64_t time : written_times) {
+            latency.add(now_ns - time);
+        }
+    }
+}
+
+void RemapEngine::on_removed(std::size_t index)
+{
+    sink.remove_gamepad(index);
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,164 @@
+#ifndef __REMAPENGINE_H
+#define __REMAPENGINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+#include "eventmonitor.h"
+#include "remaptable.h"
+
+struct libevdev_uinput;
+
+namespace evdevjoy {
+
+// SDL game controller event of the gamepad
+struct ControllerEvent
+{
+    enum class Type { BUTTON, AXIS };
+
+    Type type;
+    std::size_t gamepad;
+    ControllerButton button;    // button or axis
+    int value;                  // 0/1 for buttons, -32768 ... 32767 for axes
+    int64_t time;               // CLOCK_MONOTONIC ns of the input event
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Output sinks of the translated events
+//////////////////////////////////////////////////////////////////////////
+
+class EventSink
+{
+  public:
+    virtual ~EventSink() = default;
+    // New gamepad with the index used by the events
+    virtual void add_gamepad(std::size_t /*gamepad*/, const EvdevJoystick &/*joystick*/) {}
+    virtual void write(const ControllerEvent &event) = 0;
+    // End of the frame (SYN_REPORT) with at least one event
+    virtual void sync(std::size_t /*gamepad*/) {}
+    virtual void remove_gamepad(std::size_t /*gamepad*/) {}
+};
+
+// Events are kept in memory (tests, benchmarks)
+class MemorySink : public EventSink
+{
+  public:
+    std::vector<ControllerEvent> events;
+    std::size_t n_frames = 0;
+
+    void write(const ControllerEvent &event) override { events.push_back(event); }
+    void sync(std::size_t /*gamepad*/) override { n_frames++; }
+};
+
+// Events are only counted (option --replay without output)
+class NullSink : public EventSink
+{
+  public:
+    std::size_t n_events = 0;
+    std::size_t n_frames = 0;
+
+    void write(const ControllerEvent &/*event*/) override { n_events++; }
+    void sync(std::size_t /*gamepad*/) override { n_frames++; }
+};
+
+// One line per event: gamepad index, SDL name, value (option --monitor)
+class StreamSink : public EventSink
+{
+  public:
+    explicit StreamSink(std::ostream &os) : os(os) {}
+    void write(const ControllerEvent &event) override;
+    void sync(std::size_t gamepad) override;
+    void remove_gamepad(std::size_t gamepad) override;
+
+  private:
+    std::ostream &os;
+};
+
+// Virtual Xbox 360 like gamepad created by uinput for every gamepad (option
+// --remap): buttons BTN_SOUTH ..., d-pad ABS_HAT0X/Y, sticks ABS_X, ABS_Y,
+// ABS_RX, ABS_RY, triggers ABS_Z, ABS_RZ with the SDL ranges.
+class UinputSink : public EventSink
+{
+  public:
+    ~UinputSink() override;
+    // Throws std::system_error when uinput is not available
+    void add_gamepad(std::size_t gamepad, const EvdevJoystick &joystick) override;
+    void write(const ControllerEvent &event) override;
+    void sync(std::size_t gamepad) override;
+    void remove_gamepad(std::size_t gamepad) override;
+
+  private:
+    struct Device
+    {
+        struct libevdev_uinput *uinput = nullptr;
+        int dpad[4] = {};       // up, down, left, right
+    };
+    std::vector<Device> devices;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// RemapEngine
+//////////////////////////////////////////////////////////////////////////
+
+// Histogram of the latencies, buckets are powers of two divided into four
+// (error of the percentile is below 25 %)
+class LatencyStats
+{
+  public:
+    void add(int64_t ns);
+    uint64_t get_count() const { return count; }
+    int64_t get_max() const { return max; }
+    double get_mean() const { return (count > 0) ? double(sum) / count : 0.0; }
+    // Upper bound of the bucket with the percentile (0 ... 100)
+    int64_t get_percentile(double percentile) const;
+    void print(std::ostream &os) const;
+
+  private:
+    static const int N_BUCKETS = 64 * 4;
+    std::array<uint64_t, N_BUCKETS> buckets{};
+    uint64_t count = 0;
+    int64_t sum = 0;
+    int64_t max = 0;
+};
+
+// In-process remapping: input events of the gamepads are translated by
+// RemapTable and written to the sink, only changes of the buttons and axes
+// are written. Latency from the input event (time of the event) to the
+// written output is measured for every event, the clock is read once per
+// frame.
+class RemapEngine : public EventHandler
+{
+  public:
+    explicit RemapEngine(EventSink &sink) : sink(sink) {}
+
+    // Index of the gamepad, the same as in EventMonitor when the gamepads
+    // are added in the same order
+    std::size_t add(const EvdevJoystick &gamepad);
+    // Table of the gamepad, e.g. for other ranges of the axes
+    RemapTable& get_table(std::size_t gamepad) { return gamepads[gamepad].table; }
+
+    void on_event(std::size_t gamepad, const struct input_event &ev) override;
+    void on_frame(std::size_t gamepad, const struct input_event *events, std::size_t count) override;
+    void on_removed(std::size_t gamepad) override;
+
+    const LatencyStats& get_latency() const { return latency; }
+
+  protected:
+    struct Gamepad
+    {
+        RemapTable table;
+        std::array<int, static_cast<std::size_t>(ControllerButton::AXIS_MAX)> values{};
+        bool changed = false;   // something was written since the last sync
+    };
+
+    EventSink &sink;
+    std::vector<Gamepad> gamepads;
+    LatencyStats latency;
+    std::vector<int64_t> written_times;     // of the current frame
+};
+
+} // namespace evdevjoy
+#endif
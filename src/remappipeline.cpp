@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <system_error>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "remappipeline.h"
+
+namespace evdevjoy {
+
+// Reader threads check the stop request at least so often
+static const int READ_TIMEOUT_MS = 100;
+// Retry of the state after the dropped frame, the gamepad may not send
+// anything else
+static const int RESEND_TIMEOUT_MS = 5;
+
+static int64_t get_monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// RemapPipeline::Reader
+//////////////////////////////////////////////////////////////////////////
+
+RemapPipeline::Reader::Reader(RemapPipeline &pipeline, std::size_t index,
+        const EvdevJoystick &gamepad, std::size_t ring_frames) :
+    pipeline(pipeline),
+    index(index),
+    table(gamepad),
+    ring(ring_frames)
+{
+    kinds.fill(-1);
+    pending.count = 0;
+    monitor.add(gamepad);
+}
+
+void RemapPipeline::Reader::on_event(std::size_t gamepad, const struct input_event &ev)
+{
+    on_frame(gamepad, &ev, 1);
+}
+
+void RemapPipeline::Reader::on_frame(std::size_t /*gamepad*/, const struct input_event *events,
+    std::size_t count)
+{
+    for (std::size_t i=0; i < count; i++) {
+        const struct input_event &ev = events[i];
+        if (ev.type == EV_SYN) {
+            if (ev.code == SYN_REPORT) {
+                push_frame(int64_t(ev.input_event_sec) * 1000000000 + int64_t(ev.input_event_usec) * 1000);
+            }
+            continue;
+        }
+        table.translate(ev, [this](ControllerButton output, bool is_axis, int value) {
+            std::size_t i_output = static_cast<std::size_t>(output);
+            if (values[i_output] == value) {
+                return;
+            }
+            values[i_output] = value;
+            kinds[i_output] = is_axis ? 1 : 0;
+            // Output changed more times in one frame, the frame gets all outputs
+            if (pending.count == RemapFrame::MAX_CHANGES) {
+                resend = true;
+            }
+            if (!resend) {
+                pending.changes[pending.count++] = RemapFrame::Change{output, is_axis, value};
+            }
+        });
+    }
+}
+
+void RemapPipeline::Reader::push_frame(int64_t time, bool retry)
+{
+    if (resend) {
+        pending.count = 0;
+        for (std::size_t i=0; i < RemapFrame::MAX_CHANGES; i++) {
+            if (kinds[i] >= 0) {
+                pending.changes[pending.count++] = RemapFrame::Change{
+                    static_cast<ControllerButton>(i), kinds[i] == 1, values[i]};
+            }
+        }
+    }
+    if (pending.count == 0) {
+        return;
+    }
+
+    RemapFrame *frame = ring.begin_push();
+    if (frame == nullptr) {
+        if (!retry) {
+            drops.fetch_add(1, std::memory_order_relaxed);
+        }
+        resend = true;
+        pending.count = 0;
+        return;
+    }
+    frame->time = time;
+    frame->count = pending.count;
+    std::copy(pending.changes, pending.changes + pending.count, frame->changes);
+    ring.end_push();
+    frames.fetch_add(1, std::memory_order_relaxed);
+    std::size_t occupancy = ring.size();
+    if (occupancy > max_occupancy.load(std::memory_order_relaxed)) {
+        max_occupancy.store(occupancy, std::memory_order_relaxed);
+    }
+    resend = false;
+    pending.count = 0;
+    pipeline.wake();
+}
+
+void RemapPipeline::Reader::run()
+{
+    try {
+        while (!pipeline.stopping.load(std::memory_order_relaxed) && (monitor.size() > 0)) {
+            monitor.read_events(*this, resend ? RESEND_TIMEOUT_MS : READ_TIMEOUT_MS);
+            if (resend) {
+                push_frame(get_monotonic_ns(), true);
+            }
+        }
+    } catch (const std::exception &e) {
+        LOG(ERROR) << "RemapPipeline: gamepad " << index << ": " << e.what();
+    }
+    removed.store(true, std::memory_order_release);
+    pipeline.wake();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// RemapPipeline
+//////////////////////////////////////////////////////////////////////////
+
+RemapPipeline::RemapPipeline(EventSink &sink, std::size_t ring_frames) :
+    sink(sink),
+    ring_frames(ring_frames)
+{
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create eventfd");
+    }
+}
+
+RemapPipeline::~RemapPipeline()
+{
+    stop();
+    close(wake_fd);
+}
+
+bool RemapPipeline::add(const EvdevJoystick &gamepad)
+{
+    std::size_t index = readers.size();
+    std::unique_ptr<Reader> reader;
+    try {
+        reader = std::make_unique<Reader>(*this, index, gamepad, ring_frames);
+    } catch (const std::runtime_error &e) {
+        LOG(WARNING) << "Gamepad is not monitored: " << e.what();
+        return false;
+    }
+    readers.push_back(std::move(reader));
+    sink.add_gamepad(index, gamepad);
+    n_active++;
+    return true;
+}
+
+void RemapPipeline::start()
+{
+    // The signals are delivered to the output thread, its wait is interrupted
+    sigset_t signals, old_signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+    for (auto &reader : readers) {
+        reader->thread = std::thread(&Reader::run, reader.get());
+    }
+    pthread_sigmask(SIG_SETMASK, &old_signals, nullptr);
+    LOG(INFO) << "RemapPipeline: " << readers.size() << " reader threads, ring of "
+        << ring_frames << " frames";
+}
+
+void RemapPipeline::stop()
+{
+    stopping.store(true);
+    for (auto &reader : readers) {
+        if (reader->thread.joinable()) {
+            reader->thread.join();
+        }
+    }
+}
+
+void RemapPipeline::wake()
+{
+    // Pairs with the fence in process(): either the reader sees sleeping or
+    // the output thread sees the pushed frame
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false)) {
+        uint64_t value = 1;
+        if (write(wake_fd, &value, sizeof(value)) < 0) {
+            LOG(WARNING) << "RemapPipeline: cannot wake the output thread";
+        }
+    }
+}
+
+bool RemapPipeline::drain()
+{
+    bool written = false;
+    for (auto &reader_ptr : readers) {
+        Reader &reader = *reader_ptr;
+        if (reader.removed_reported) {
+            continue;
+        }
+        // Frames pushed before removed are visible after its load
+        bool removed = reader.removed.load(std::memory_order_acquire);
+        while (RemapFrame *frame = reader.ring.front()) {
+            for (std::size_t i=0; i < frame->count; i++) {
+                const RemapFrame::Change &change = frame->changes[i];
+                sink.write(ControllerEvent{
+                    change.is_axis ? ControllerEvent::Type::AXIS : ControllerEvent::Type::BUTTON,
+                    reader.index, change.button, change.value, frame->time});
+            }
+            sink.sync(reader.index);
+            int64_t now = get_monotonic_ns();
+            for (std::size_t i=0; i < frame->count; i++) {
+                latency.add(now - frame->time);
+            }
+            reader.ring.pop();
+            written = true;
+        }
+        if (removed) {
+            sink.remove_gamepad(reader.index);
+            reader.removed_reported = true;
+            n_active--;
+            written = true;
+        }
+    }
+    return written;
+}
+
+bool RemapPipeline::process(int timeout_ms)
+{
+    if (drain()) {
+        return true;
+    }
+
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (drain()) {
+        sleeping.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    struct pollfd fds = {wake_fd, POLLIN, 0};
+    int rc = poll(&fds, 1, timeout_ms);
+    sleeping.store(false, std::memory_order_relaxed);
+    if (rc < 0) {
+        if (errno == EINTR) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(), "Cannot wait for the frames");
+    }
+    if (rc > 0) {
+        uint64_t value;
+        if (read(wake_fd, &value, sizeof(value)) < 0) {
+            // EAGAIN, the other wake was already consumed
+        }
+    }
+    return drain();
+}
+
+RemapPipeline::RingStats RemapPipeline::get_ring_stats(std::size_t gamepad) const
+{
+    const Reader &reader = *readers[gamepad];
+    RingStats stats;
+    stats.capacity = reader.ring.capacity();
+    stats.occupancy = reader.ring.size();
+    stats.max_occupancy = reader.max_occupancy.load(std::memory_order_relaxed);
+    stats.frames = reader.frames.load(std::memory_order_relaxed);
+    stats.drops = reader.drops.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace evdevjoy
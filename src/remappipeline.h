@@ -0,0 +1,143 @@
+#ifndef __REMAPPIPELINE_H
+#define __REMAPPIPELINE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "eventmonitor.h"
+#include "parallel.h"
+#include "remapengine.h"
+#include "remaptable.h"
+
+namespace evdevjoy {
+
+// Translated changes of one input frame of the gamepad
+struct RemapFrame
+{
+    static const std::size_t MAX_CHANGES = static_cast<std::size_t>(ControllerButton::AXIS_MAX);
+
+    struct Change
+    {
+        ControllerButton button;
+        bool is_axis;
+        int value;
+    };
+
+    int64_t time;               // CLOCK_MONOTONIC ns of the input frame
+    std::size_t count;
+    Change changes[MAX_CHANGES];
+};
+
+// Multi-threaded RemapEngine (option --threaded): every gamepad is read
+// and translated by its own thread into its own SpscRing of RemapFrame,
+// the rings are consumed by the output thread (the caller of process())
+// which writes to the sink. A slow gamepad or its full ring does not delay
+// other gamepads. When the ring is full the frame is dropped and the next
+// frame carries the state of all outputs of the gamepad.
+class RemapPipeline
+{
+  public:
+    static const std::size_t DEFAULT_RING_FRAMES = 256;
+
+    // Counters of one ring, read from any thread
+    struct RingStats
+    {
+        std::size_t capacity;
+        std::size_t occupancy;      // frames in the ring now
+        std::size_t max_occupancy;
+        uint64_t frames;            // pushed frames
+        uint64_t drops;             // input frames dropped on the full ring
+    };
+
+    // Throws std::system_error
+    explicit RemapPipeline(EventSink &sink, std::size_t ring_frames = DEFAULT_RING_FRAMES);
+    ~RemapPipeline();
+
+    // Add the opened gamepad before start(), its index in the sink is the
+    // number of the gamepads added before. Returns false (logged) when the
+    // gamepad cannot be watched. Throws std::runtime_error,
+    // std::system_error from the sink.
+    bool add(const EvdevJoystick &gamepad);
+    RemapTable& get_table(std::size_t gamepad) { return readers[gamepad]->table; }
+    // Start the reader threads, SIGINT and SIGTERM are blocked in them
+    void start();
+    // Stop and join the reader threads, called by the destructor
+    void stop();
+
+    // Output stage: write the frames of all rings into the sink, wait up
+    // to timeout_ms (-1 without limit) when there is none. Returns false on
+    // timeout or signal. Removed gamepad is reported to the sink when its
+    // ring is drained.
+    bool process(int timeout_ms = -1);
+    // Number of gamepads which are not removed
+    std::size_t size() const { return n_active; }
+
+    RingStats get_ring_stats(std::size_t gamepad) const;
+    // Latency from the input event to the sink, only from the output thread
+    const LatencyStats& get_latency() const { return latency; }
+
+  protected:
+    // Reader thread of one gamepad, the producer of the ring
+    class Reader : public EventHandler
+    {
+      public:
+        Reader(RemapPipeline &pipeline, std::size_t index, const EvdevJoystick &gamepad,
+            std::size_t ring_frames);
+
+        void on_event(std::size_t gamepad, const struct input_event &ev) override;
+        void on_frame(std::size_t gamepad, const struct input_event *events, std::size_t count) override;
+        void on_removed(std::size_t /*gamepad*/) override {}
+        void run();
+
+        RemapPipeline &pipeline;
+        std::size_t index;
+        RemapTable table;
+        EventMonitor monitor;
+        parallel::SpscRing<RemapFrame> ring;
+        std::thread thread;
+        std::atomic<bool> removed{false};
+        bool removed_reported = false;          // output thread
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> drops{0};
+        std::atomic<std::size_t> max_occupancy{0};
+
+      protected:
+        // Last value of every output (0 at the start as RemapEngine), kind of
+        // the output: -1 never changed, 0 button, 1 axis
+        std::array<int, RemapFrame::MAX_CHANGES> values{};
+        std::array<int8_t, RemapFrame::MAX_CHANGES> kinds;
+        bool resend = false;    // the last frame was dropped
+        RemapFrame pending;
+
+        // Retry is the state after the dropped frame, it is not counted as
+        // the drop
+        void push_frame(int64_t time, bool retry = false);
+    };
+
+    EventSink &sink;
+    std::size_t ring_frames;
+    std::vector<std::unique_ptr<Reader>> readers;
+    std::size_t n_active = 0;
+    std::atomic<bool> stopping{false};
+    // The output thread waits on the eventfd, readers write it only when
+    // it is sleeping
+    int wake_fd = -1;
+    std::atomic<bool> sleeping{false};
+    LatencyStats latency;
+
+    void wake();
+    // Write the frames of all rings, returns true when any was written
+    bool drain();
+
+  private:
+    // Disable copy constructor and assign operator
+    RemapPipeline(const RemapPipeline&) = delete;
+    RemapPipeline& operator=(const RemapPipeline&) = delete;
+};
+
+} // namespace evdevjoy
+#endif
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <tuple>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "remaptable.h"
+
+namespace evdevjoy {
+
+static AxisRange get_range(ControllerAxisType axis_type)
+{
+    switch (axis_type) {
+        case ControllerAxisType::HALF_AXIS_POSITIVE:
+            return {0, RemapTable::AXIS_MAX};
+        case ControllerAxisType::HALF_AXIS_NEGATIVE:
+            return {0, RemapTable::AXIS_MIN};
+        default:
+            return {RemapTable::AXIS_MIN, RemapTable::AXIS_MAX};
+    }
+}
+
+RemapTable::RemapTable()
+{
+    // SDL range, hats -1 ... 1
+    for (unsigned int code=0; code < ABS_CNT; code++) {
+        bool is_hat = (code >= ABS_HAT0X) && (code <= ABS_HAT3Y);
+        abs_info[code] = input_absinfo{};
+        abs_info[code].minimum = is_hat ? -1 : AXIS_MIN;
+        abs_info[code].maximum = is_hat ? 1 : AXIS_MAX;
+    }
+}
+
+RemapTable::RemapTable(const EvdevJoystick &gamepad) : RemapTable()
+{
+    for (unsigned int code=0; code < ABS_CNT; code++) {
+        const struct input_absinfo *absinfo = gamepad.get_abs_info(code);
+        if (absinfo != nullptr) {
+            abs_info[code] = *absinfo;
+        }
+    }
+
+    // Targets sorted by the event, the slot is a continuous range
+    std::vector<std::tuple<unsigned, unsigned, Target>> bound;
+    for (int i=0; i < static_cast<int>(ControllerButton::AXIS_MAX); i++) {
+        ControllerButton button = static_cast<ControllerButton>(i);
+        EventButtonBinding event_binding = gamepad.get_event_binding(button);
+        if (!event_binding) {
+            continue;
+        }
+        const ButtonBinding &bind = *event_binding.bind;
+        Target target = {};
+        target.output = button;
+        target.output_axis = (bind.output_type == BindType::BINDTYPE_AXIS);
+        target.input_type = bind.input_type;
+        target.hat_mask = bind.input.hat_mask;
+        target.input = get_range(bind.input.axis_type);
+        if (bind.input.invert_input) {
+            // Inverted input has swapped range
+            std::swap(target.input.min, target.input.max);
+        }
+        if ((button == ControllerButton::AXIS_TRIGGERLEFT) ||
+            (button == ControllerButton::AXIS_TRIGGERRIGHT))
+        {
+            target.output_range = {0, AXIS_MAX};
+        } else {
+            target.output_range = get_range(bind.output.axis_type);
+        }
+        bound.emplace_back(event_binding.event->type, event_binding.event->code, target);
+    }
+    std::stable_sort(bound.begin(), bound.end(), [](auto const &a, auto const &b) {
+        return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+    });
+
+    for (auto const &[type, code, target] : bound) {
+        Slot *slot = nullptr;
+        if ((type == EV_KEY) && (code < KEY_CNT)) {
+            slot = &key_slots[code];
+        } else if ((type == EV_ABS) && (code < ABS_CNT)) {
+            slot = &abs_slots[code];
+        } else {
+            LOG(WARNING) << "RemapTable: unsupported event " << type << ":" << code;
+            continue;
+        }
+        if (slot->count == 0) {
+            slot->first = static_cast<uint8_t>(targets.size());
+        }
+        slot->count++;
+        targets.push_back(target);
+    }
+    for (unsigned int code=0; code < ABS_CNT; code++) {
+        build_transforms(code);
+    }
+}
+
+void RemapTable::set_abs_info(unsigned int code, const struct input_absinfo &absinfo)
+{
+    if (code < ABS_CNT) {
+        abs_info[code] = absinfo;
+        build_transforms(code);
+    }
+}
+
+void RemapTable::build_transforms(unsigned int code)
+{
+    const Slot &slot = abs_slots[code];
+    for (unsigned i = slot.first; i < slot.first + slot.count; i++) {
+        Target &target = targets[i];
+        if (target.input_type == BindType::BINDTYPE_AXIS) {
+            target.transform = AxisTransform(abs_info[code], target.input,
+                target.output_axis, target.output_range);
+        }
+    }
+}
+
+// Direction of the hat (HatMask) from the value of its x or y event
+int RemapTable::get_hat_mask(unsigned int code, int value) const
+{
+    const struct input_absinfo &absinfo = abs_info[code];
+    int center = (absinfo.minimum + absinfo.maximum) / 2;
+    bool is_y = ((code - ABS_HAT0X) % 2) != 0;
+    if (value < center) {
+        return is_y ? HatMask::UP : HatMask::LEFT;
+    }
+    if (value > center) {
+        return is_y ? HatMask::DOWN : HatMask::RIGHT;
+    }
+    return 0;
+}
+
+int RemapTable::apply(const Target &target, unsigned int code, int raw) const
+{
+    if (target.input_type == BindType::BINDTYPE_AXIS) {
+        return target.transform(raw);
+    }
+
+    bool pressed;
+    if (target.input_type == BindType::BINDTYPE_HAT) {
+        pressed = (get_hat_mask(code, raw) & target.hat_mask) != 0;
+    } else {
+        pressed = (raw != 0);
+    }
+    if (target.output_axis) {
+        return pressed ? target.output_range.max : target.output_range.min;
+    }
+    return pressed;
+}
+
+} // namespace evdevjoy
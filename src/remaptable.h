@@ -0,0 +1,91 @@
+#ifndef __REMAPTABLE_H
+#define __REMAPTABLE_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <linux/input.h>
+#include "axistransform.h"
+#include "evdevjoy.h"
+
+namespace evdevjoy {
+
+// Bindings of one gamepad precomputed for the translation of the input
+// events into SDL button and axis values, the same rules as
+// SDL_gamecontroller.c (axis ranges, half axes, inverted input, threshold
+// of the axis bound to button, hat directions, triggers 0 ... 32767).
+//
+// The bindings of the event are found by one load from the dense table
+// indexed by the event code, no hashing and no search. The axis of the
+// binding is translated by its AxisTransform built from the range of the
+// device axis.
+class RemapTable
+{
+  public:
+    static const int AXIS_MIN = -32768;
+    static const int AXIS_MAX = 32767;
+
+    RemapTable();
+    // Bindings of the gamepad (set_mapping()), the ranges of the axes are
+    // taken from the opened device, the gamepad described by sysfs or
+    // snapshot gets the SDL range
+    explicit RemapTable(const EvdevJoystick &gamepad);
+
+    // Range of the axis or hat reported by the device, the transforms of
+    // the axis are built again
+    void set_abs_info(unsigned int code, const struct input_absinfo &absinfo);
+    const struct input_absinfo& get_abs_info(unsigned int code) const { return abs_info[code]; }
+
+    // Call func(ControllerButton output, bool is_axis, int value) for every
+    // binding of the event. Buttons are 0/1, axes -32768 ... 32767.
+    template <typename Func>
+    void translate(const struct input_event &ev, Func func) const
+    {
+        Slot slot;
+        if ((ev.type == EV_KEY) && (ev.code < KEY_CNT)) {
+            slot = key_slots[ev.code];
+        } else if ((ev.type == EV_ABS) && (ev.code < ABS_CNT)) {
+            slot = abs_slots[ev.code];
+        } else {
+            return;
+        }
+        for (unsigned i = slot.first; i < slot.first + slot.count; i++) {
+            const Target &target = targets[i];
+            func(target.output, target.output_axis, apply(target, ev.code, ev.value));
+        }
+    }
+
+    std::size_t size() const { return targets.size(); }
+
+  protected:
+    // Precomputed binding
+    struct Target
+    {
+        ControllerButton output;
+        bool output_axis;
+        BindType input_type;
+        int hat_mask;
+        AxisRange input;        // axis input
+        AxisRange output_range; // axis output
+        AxisTransform transform;    // axis input
+    };
+
+    // Targets[first, first+count) of the event code
+    struct Slot
+    {
+        uint8_t first = 0;
+        uint8_t count = 0;
+    };
+
+    std::array<Slot, KEY_CNT> key_slots;
+    std::array<Slot, ABS_CNT> abs_slots;
+    std::vector<Target> targets;
+    std::array<struct input_absinfo, ABS_CNT> abs_info;
+
+    void build_transforms(unsigned int code);
+    int apply(const Target &target, unsigned int code, int raw) const;
+    int get_hat_mask(unsigned int code, int value) const;
+};
+
+} // namespace evdevjoy
+#endif
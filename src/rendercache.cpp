@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "sdlxboxmap"
+#endif
+#include "logging.h"
+
+#include "outputfile.h"
+#include "rendercache.h"
+
+namespace fs = std::filesystem;
+using namespace evdevjoy;
+
+namespace sdlxboxmap {
+
+// Change when the rendered output changes for the same input
+static const char *RENDER_CACHE_FORMAT = "sdlxboxmap render cache 1";
+
+//////////////////////////////////////////////////////////////////////////
+// Key hash
+//////////////////////////////////////////////////////////////////////////
+
+// Two 64 bit lanes updated by 8 byte words, every value is prefixed by its
+// size so that the concatenated values cannot collide. Not cryptographic,
+// the cache directory is trusted.
+class KeyHash
+{
+  public:
+    void update(std::string_view data) {
+        update_word(data.size());
+        std::size_t i = 0;
+        for (; i + 8 <= data.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            update_word(word);
+        }
+        uint64_t tail = 0;
+        if (i < data.size()) {
+            std::memcpy(&tail, data.data() + i, data.size() - i);
+        }
+        update_word(tail);
+    }
+
+    void update(uint64_t value) { update_word(value); }
+
+    std::string hexdigest() const {
+        static const char digits[] = "0123456789abcdef";
+        uint64_t h[2] = { mix(a ^ rotl(b, 32)), mix(b + a) };
+        std::string digest(32, '0');
+        for (int i=0; i < 32; i++) {
+            digest[i] = digits[(h[i / 16] >> (60 - 4 * (i % 16))) & 0xf];
+        }
+        return digest;
+    }
+
+  private:
+    uint64_t a = 0x243f6a8885a308d3ULL;
+    uint64_t b = 0x13198a2e03707344ULL;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    void update_word(uint64_t word) {
+        a = rotl((a ^ word) * 0x9e3779b97f4a7c15ULL, 31);
+        b = mix(b + word) ^ rotl(b, 23);
+    }
+};
+
+static void update_event(KeyHash &hash, const EventType &event)
+{
+    hash.update((uint64_t(event.type) << 32) | event.code);
+}
+
+static void update_binding(KeyHash &hash, const ButtonBinding &bind)
+{
+    hash.update(static_cast<uint64_t>(bind.input_type));
+    hash.update(static_cast<uint64_t>(bind.input.button));
+    hash.update(static_cast<uint64_t>(bind.input.axis));
+    hash.update(static_cast<uint64_t>(bind.input.axis_type));
+    hash.update(static_cast<uint64_t>(bind.input.invert_input));
+    hash.update(static_cast<uint64_t>(bind.input.hat));
+    hash.update(static_cast<uint64_t>(bind.input.hat_mask));
+    hash.update(static_cast<uint64_t>(bind.output_type));
+    hash.update(static_cast<uint64_t>(bind.output.button));
+    hash.update(static_cast<uint64_t>(bind.output.axis));
+    hash.update(static_cast<uint64_t>(bind.output.axis_type));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// RenderCache
+//////////////////////////////////////////////////////////////////////////
+
+RenderCache::RenderCache(std::string directory, uint64_t size_limit) :
+    directory(std::move(directory)), size_limit(size_limit)
+{
+    std::error_code ec;
+    fs::create_directories(this->directory, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create render cache '" + this->directory + "': " + ec.message());
+    }
+}
+
+// Format of the cache and the identity of the executable (size and
+// modification time), a rebuilt tool does not use the old entries
+const std::string& RenderCache::get_tool_version()
+{
+    static const std::string version = [] {
+        std::string version(RENDER_CACHE_FORMAT);
+        struct stat st;
+        if (stat("/proc/self/exe", &st) == 0) {
+            version += " " + std::to_string(st.st_size) + " " + std::to_string(st.st_mtim.tv_sec)
+                + "." + std::to_string(st.st_mtim.tv_nsec);
+        }
+        return version;
+    }();
+    return version;
+}
+
+// Everything read by TemplateProgram::render(): the template, the device
+// path and the event bound to every button and axis
+std::string RenderCache::make_key(const TemplateProgram &program, const EvdevJoystick &gamepad)
+{
+    KeyHash hash;
+    hash.update(get_tool_version());
+    hash.update(program.get_source());
+    hash.update(gamepad.devname);
+
+    hash.update(gamepad.buttons.size());
+    for (auto const &event : gamepad.buttons) {
+        update_event(hash, event);
+    }
+    hash.update(gamepad.hats.size());
+    for (auto const &hat : gamepad.hats) {
+        update_event(hash, hat.x);
+        update_event(hash, hat.y);
+    }
+    hash.update(gamepad.axes.size());
+    for (auto const &event : gamepad.axes) {
+        update_event(hash, event);
+    }
+
+    for (int i=0; i < static_cast<int>(ControllerButton::AXIS_MAX); i++) {
+        ControllerButton button = static_cast<ControllerButton>(i);
+        if (button == ControllerButton::BUTTON_MAX) {
+            continue;
+        }
+        EventButtonBinding event_binding = gamepad.get_event_binding(button);
+        hash.update(static_cast<uint64_t>(static_cast<bool>(event_binding)));
+        if (event_binding) {
+            update_event(hash, *event_binding.event);
+            update_binding(hash, *event_binding.bind);
+        }
+    }
+    return hash.hexdigest();
+}
+
+std::string RenderCache::get_filename(const std::string &key) const
+{
+    return directory + "/" + key.substr(0, 2) + "/" + key;
+}
+
+std::string RenderCache::find(const std::string &key)
+{
+    std::string filename = get_filename(key);
+    // Modification time is the time of the last use, see evict()
+    if (utimensat(AT_FDCWD, filename.c_str(), nullptr, 0) != 0) {
+        misses++;
+        return "";
+    }
+    hits++;
+    return filename;
+}
+
+void RenderCache::store(const std::string &key, const platform::IovecBuffer &output)
+{
+    std::string filename = get_filename(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(filename).parent_path(), ec);
+    try {
+        platform::update_file(filename, output);
+    } catch (const std::system_error &e) {
+        LOG(WARNING) << "Cannot store output into render cache: " << e.what();
+    }
+}
+
+void RenderCache::evict()
+{
+    struct Entry {
+        fs::file_time_type time;
+        uintmax_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directory, ec), end; !ec && (it != end); it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec)) {
+            continue;
+        }
+        Entry entry{it->last_write_time(entry_ec), it->file_size(entry_ec), it->path()};
+        if (!entry_ec) {
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+    if (total <= size_limit) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.time < b.time;
+    });
+    std::size_t n_removed = 0;
+    for (auto const &entry : entries) {
+        if (total <= size_limit) {
+            break;
+        }
+        if (fs::remove(entry.path, ec)) {
+            total -= entry.size;
+            n_removed++;
+        }
+    }
+    LOG(INFO) << "Render cache: removed " << n_removed << " entries, size " << total << " bytes";
+}
+
+} // namespace sdlxboxmap
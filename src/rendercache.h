@@ -0,0 +1,59 @@
+#ifndef __RENDERCACHE_H
+#define __RENDERCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "evdevjoy.h"
+#include "iovecbuffer.h"
+#include "tplprogram.h"
+
+namespace sdlxboxmap {
+
+// Content addressed cache of the rendered outputs, option --render-cache.
+// The key is a 128 bit hash of the tool version, the template source, the
+// bindings of the gamepad and its device layout (device path and events).
+// Hit returns the cached file which is copied to the output, the template
+// is not rendered. Entries are stored in DIR/<2 hex>/<32 hex>, the least
+// recently used entries are removed by evict() when the cache is larger
+// than the size limit.
+//
+// find() and store() can be called from more threads.
+class RenderCache
+{
+  public:
+    RenderCache(std::string directory, uint64_t size_limit);
+
+    static std::string make_key(const TemplateProgram &program,
+        const evdevjoy::EvdevJoystick &gamepad);
+
+    // File of the cached output, empty on miss
+    std::string find(const std::string &key);
+    // The file returned by find() cannot be read (removed by other process
+    // sharing the directory), the lookup is counted as a miss
+    void lost_hit() { hits--; misses++; }
+    // Save the rendered output, errors are only logged
+    void store(const std::string &key, const platform::IovecBuffer &output);
+    // Remove the oldest entries above the size limit
+    void evict();
+
+    std::size_t get_hits() const { return hits; }
+    std::size_t get_misses() const { return misses; }
+
+  protected:
+    std::string directory;
+    uint64_t size_limit;
+    std::atomic<std::size_t> hits{0};
+    std::atomic<std::size_t> misses{0};
+
+    std::string get_filename(const std::string &key) const;
+    static const std::string& get_tool_version();
+
+  private:
+    // Disable copy constructor and assign operator
+    RenderCache(const RenderCache&) = delete;
+    RenderCache& operator=(const RenderCache&) = delete;
+};
+
+} // namespace sdlxboxmap
+#endif
@@ -7,98 +7,60 @@
 #include <chrono>
 #include <fstream>
 #include <ios>
+#include <system_error>
+#include <atomic>
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
 
 #include "logging.h"
 #include "sdlxboxmap.h"
+#include "outputfile.h"
 #include "stringext.h"
 #include "bitext.h"
 #include "platform.h"
+#include "bindb.h"
+#include "parallel.h"
+#include "sysfsinput.h"
+#include "hotplug.h"
+#include "snapshot.h"
+#include "devicelayout.h"
+#include "eventmonitor.h"
+#include "remapengine.h"
+#include "remappipeline.h"
+#include "eventtrace.h"
 
 using namespace evdevjoy;
 using std::chrono::high_resolution_clock;
 
 namespace fs = std::filesystem;
-// https://gist.github.com/meghprkh/9cdce0cd4e0f41ce93413b250a207a55
-//https://meghprkh.github.io/blog/posts/handling-joysticks-and-gamepads-in-linux/
-
 
-void test_joystick(std::string const &dev_path) {
-    int rc;
-    int fd;
-    struct libevdev *dev = NULL;
+// Wait for the late device probes before the exit
+static const std::chrono::milliseconds PROBE_EXIT_TIMEOUT(500);
 
-    fd = open(dev_path.c_str(), O_RDONLY|O_NONBLOCK);
-    rc = libevdev_new_from_fd(fd, &dev);
-    std::cout << "Open device: " << dev << std::endl;
-    if (rc < 0) {
-        std::cerr << "Failed to init libevdev (" << dev_path << ")\n" \
-            << std::strerror(-rc) << std::endl;
-        exit(1);
-    }
-    
-    std::cout << "Device name: " << libevdev_get_name(dev) << std::endl;
-    do {
-        struct input_event ev;
-        rc = libevdev_next_event(dev, LIBEVDEV_READ_FLAG_NORMAL, &ev);
-        if (rc == 0) {
-            std::cout << "EVENT type: " << ev.type << ", code: " << ev.code << ", value" << ev.value << std::endl;
-        }
-    } while (rc == 1 || rc == 0 || rc == -EAGAIN);
+[[noreturn]] static void exit_app(int status)
+{
+    EvdevJoystick::finish_probes(PROBE_EXIT_TIMEOUT, status);
+    exit(status);
 }
 
+// https://gist.github.com/meghprkh/9cdce0cd4e0f41ce93413b250a207a55
+//https://meghprkh.github.io/blog/posts/handling-joysticks-and-gamepads-in-linux/
+
+
 namespace sdlxboxmap {
 namespace ev = evdevjoy;
 
-typedef std::unordered_map<std::string_view, ControllerButton> t_MapButton2SDLButton;
-static const t_MapButton2SDLButton MapButton2SDLButton = {
-    {"a", ControllerButton::BUTTON_A},
-    {"b", ControllerButton::BUTTON_B},
-    {"x", ControllerButton::BUTTON_X},
-    {"y", ControllerButton::BUTTON_Y},
-    {"back", ControllerButton::BUTTON_BACK},
-    {"guide", ControllerButton::BUTTON_GUIDE},
-    {"start", ControllerButton::BUTTON_START},
-    {"tl", ControllerButton::BUTTON_LEFTSTICK},
-    {"leftstick", ControllerButton::BUTTON_LEFTSTICK},
-    {"tr", ControllerButton::BUTTON_LEFTSTICK},
-    {"rightstick", ControllerButton::BUTTON_RIGHTSTICK},
-    {"lb", ControllerButton::BUTTON_LEFTSHOULDER},
-    {"leftshoulder", ControllerButton::BUTTON_LEFTSHOULDER},
-    {"rb", ControllerButton::BUTTON_RIGHTSHOULDER},
-    {"rightshoulder", ControllerButton::BUTTON_RIGHTSHOULDER},
-    {"dpad_y", ControllerButton::BUTTON_DPAD_UP},
-    {"dpup", ControllerButton::BUTTON_DPAD_UP},
-    {"duup", ControllerButton::BUTTON_DPAD_UP},
-    {"du", ControllerButton::BUTTON_DPAD_UP},
-    {"dpdown", ControllerButton::BUTTON_DPAD_DOWN},
-    {"dd", ControllerButton::BUTTON_DPAD_DOWN},
-    {"ddown", ControllerButton::BUTTON_DPAD_DOWN},
-    {"dpad_x", ControllerButton::BUTTON_DPAD_LEFT},
-    {"dpleft", ControllerButton::BUTTON_DPAD_LEFT},
-    {"dlleft", ControllerButton::BUTTON_DPAD_LEFT},
-    {"dl", ControllerButton::BUTTON_DPAD_LEFT},
-    {"dpright", ControllerButton::BUTTON_DPAD_RIGHT},
-    {"drright", ControllerButton::BUTTON_DPAD_RIGHT},
-    {"dr", ControllerButton::BUTTON_DPAD_RIGHT},
-    {"misc1", ControllerButton::BUTTON_MISC1},
-    {"paddle1", ControllerButton::BUTTON_PADDLE1},
-    {"paddle2", ControllerButton::BUTTON_PADDLE2},
-    {"paddle3", ControllerButton::BUTTON_PADDLE3},
-    {"paddle4", ControllerButton::BUTTON_PADDLE4},
-    {"touchpad", ControllerButton::BUTTON_TOUCHPAD},
-    {"x1", ControllerButton::AXIS_LEFTX},
-    {"leftx", ControllerButton::AXIS_LEFTX},
-    {"y1", ControllerButton::AXIS_LEFTY},
-    {"lefty", ControllerButton::AXIS_LEFTY},
-    {"x2", ControllerButton::AXIS_RIGHTX},
-    {"rightx", ControllerButton::AXIS_RIGHTX},
-    {"y2", ControllerButton::AXIS_RIGHTY},
-    {"righty", ControllerButton::AXIS_RIGHTY},
-    {"lt", ControllerButton::AXIS_TRIGGERLEFT},
-    {"lefttrigger", ControllerButton::AXIS_TRIGGERLEFT},
-    {"rt", ControllerButton::AXIS_TRIGGERRIGHT},
-    {"righttrigger", ControllerButton::AXIS_TRIGGERRIGHT},
-};
+// dev/input in the parent of the sysfs root, /dev/input for /sys, so the
+// fake tree of --sysfs does not point to the devices of the host
+static std::string get_dev_root(const std::string &sysfs_root)
+{
+    fs::path root = fs::path(sysfs_root).lexically_normal();
+    if (!root.has_filename()) {
+        root = root.parent_path();
+    }
+    return (root.parent_path() / "dev" / "input").string();
+}
 
 MainAppException::MainAppException(const std::string& msg) :
     std::runtime_error(msg)
@@ -108,7 +70,6 @@ MainAppException::MainAppException(const std::string& msg) :
 
 MainApp::MainApp()
 {
-    joymap.add_default_mapping();
 }
 
 std::unique_ptr<cxxopts::Options> MainApp::init_arg_parser()
@@ -123,7 +84,8 @@ std::unique_ptr<cxxopts::Options> MainApp::init_arg_parser()
     options->add_options()
         ("h,help", "Print this help", cxxopts::value<bool>()->default_value("false"))
         ("l,list", "List of gamepad devices")
-        ("t,template", "Configuration template", cxxopts::value<std::string>())
+        ("t,template", "Configuration template, can be repeated with --fleet", 
+            cxxopts::value<std::vector<std::string>>())
         ("d,tdir", "Directory (database) with list of template files based on "
             "<guid_id>.tpl", cxxopts::value<std::string>())
         ("g,guid", "For which gamepad guid prepare the configuration", 
@@ -133,8 +95,63 @@ std::unique_ptr<cxxopts::Options> MainApp::init_arg_parser()
             cxxopts::value<std::vector<std::string>>()
             ->default_value(""))
         ("o,output", "Output file", cxxopts::value<std::string>())
+        ("j,jobs", "Number of threads rendering the templates, 0 for the number "
+            "of CPUs", cxxopts::value<unsigned>()->default_value("0"), "N")
+        ("probe-timeout", "Skip gamepad which does not respond in MS milliseconds, "
+            "0 waits without limit", cxxopts::value<unsigned>()->default_value("2000"), "MS")
+        ("daemon", "Keep running and render the output (-t, -o) of every gamepad "
+            "when it is connected, remove it when the gamepad is disconnected")
+        ("monitor", "Print the SDL button and axis events of the connected "
+            "gamepads (-g, -f) translated by the mapping database")
+        ("remap", "Remap the connected gamepads (-g, -f) by the mapping database "
+            "into virtual Xbox 360 gamepads (uinput), replaces xboxdrv")
+        ("threaded", "With --monitor or --remap read every gamepad by its own "
+            "thread, the translated frames are passed to the output thread")
+        ("ring-frames", "Frames of the ring of one gamepad with --threaded, "
+            "the frames are dropped when the ring is full", 
+            cxxopts::value<unsigned>()->default_value("256"), "N")
+        ("record", "Record the events of the connected gamepads (-g, -f) into "
+            "the trace FILE until interrupted, see --replay", 
+            cxxopts::value<std::string>(), "FILE")
+        ("replay", "Replay the trace FILE (--record) without the gamepads, the "
+            "events are printed with --monitor or remapped with --remap", 
+            cxxopts::value<std::string>(), "FILE")
+        ("replay-speed", "Speed of --replay, 1 for the recorded timing, 0 for "
+            "the maximum speed", cxxopts::value<double>()->default_value("1"), "X")
+        ("sysfs", "Read the gamepads from sysfs (ROOT, default /sys) without "
+            "opening the devices, use --sysfs=ROOT for other root", 
+            cxxopts::value<std::string>()->implicit_value("/sys"), "ROOT")
+        ("dev-root", "Device nodes of the gamepads read by --sysfs, default "
+            "dev/input next to the sysfs ROOT (/dev/input for /sys)", 
+            cxxopts::value<std::string>(), "DIR")
+        ("fleet", "Render the templates (-t) for every mapping of the databases, "
+            "or for the guids given by -g, into DIR/<guid>/<template>.conf", 
+            cxxopts::value<std::string>(), "DIR")
+        ("snapshot", "Save the connected gamepads into FILE, see --from-snapshot", 
+            cxxopts::value<std::string>(), "FILE")
+        ("from-snapshot", "Use gamepads saved in FILE (--snapshot) instead of "
+            "the connected gamepads, can be repeated", 
+            cxxopts::value<std::vector<std::string>>(), "FILE")
+        ("probe-cache", "Cache of the probed gamepads, the gamepad found in FILE "
+            "is not opened when its sysfs capabilities are unchanged", 
+            cxxopts::value<std::string>(), "FILE")
+        ("render-cache", "Cache of the rendered outputs in DIR, unchanged template, "
+            "mapping and gamepad are copied from the cache without rendering", 
+            cxxopts::value<std::string>(), "DIR")
+        ("render-cache-size", "Size limit of the render cache in MB, the least "
+            "recently used outputs are removed", 
+            cxxopts::value<unsigned>()->default_value("64"), "MB")
         ("log", "Logfile, disabled by default", cxxopts::value<std::string>())
+        ("db", "Load mapping database FILE, text gamecontrollerdb.txt format "
+            "or binary (see --compile-db), can be repeated", 
+            cxxopts::value<std::vector<std::string>>(), "FILE")
+        ("compile-db", "Compile SDL mapping database IN.txt into binary "
+            "database OUT.bin: --compile-db IN.txt OUT.bin")
+        ("positional", "Positional parameters", 
+            cxxopts::value<std::vector<std::string>>())
         ;
+    options->parse_positional({"positional"});
+    options->positional_help("[IN.txt OUT.bin]");
     return options;
 }
 
@@ -146,438 +163,949 @@ void MainApp::arg_parse(int argc, char* argv[])
         if (parsed_args.count("log")) {
             logging_to_file(parsed_args["log"].as<std::string>());
         }
-        if (parsed_args.count("list")) {
+        jobs = parsed_args["jobs"].as<unsigned>();
+        probe_timeout = std::chrono::milliseconds(parsed_args["probe-timeout"].as<unsigned>());
+        if (parsed_args.count("from-snapshot")) {
+            snapshot_files = parsed_args["from-snapshot"].as<std::vector<std::string>>();
+        }
+        if (parsed_args.count("probe-cache")) {
+            probe_cache_file = parsed_args["probe-cache"].as<std::string>();
+        }
+        render_cache_size = uint64_t(parsed_args["render-cache-size"].as<unsigned>()) << 20;
+        if (parsed_args.count("render-cache")) {
+            render_cache_dir = parsed_args["render-cache"].as<std::string>();
+            try {
+                render_cache = std::make_unique<RenderCache>(render_cache_dir, render_cache_size);
+            } catch (const std::runtime_error &e) {
+                throw MainAppException(e.what());
+            }
+        }
+        if (parsed_args.count("sysfs")) {
+            sysfs_root = parsed_args["sysfs"].as<std::string>();
+            dev_root = get_dev_root(sysfs_root);
+        }
+        if (parsed_args.count("dev-root")) {
+            dev_root = parsed_args["dev-root"].as<std::string>();
+        }
+        if (parsed_args.count("db")) {
+            db_files = parsed_args["db"].as<std::vector<std::string>>();
+        }
+        if (parsed_args.count("replay")) {
+            replay_file = parsed_args["replay"].as<std::string>();
+        }
+        replay_speed = std::max(parsed_args["replay-speed"].as<double>(), 0.0);
+        threaded = (parsed_args.count("threaded") > 0);
+        ring_frames = std::max(parsed_args["ring-frames"].as<unsigned>(), 1u);
+
+        if (parsed_args.count("compile-db")) {
+            std::vector<std::string> files;
+            if (parsed_args.count("positional")) {
+                files = parsed_args["positional"].as<std::vector<std::string>>();
+            }
+            if (files.size() != 2) {
+                throw MainAppException("Option --compile-db requires input and output file.");
+            }
+            compile_db(files[0], files[1]);
+        } else if (parsed_args.count("fleet")) {
+            run_fleet(parsed_args);
+        } else if (parsed_args.count("snapshot")) {
+            save_snapshot(parsed_args["snapshot"].as<std::string>());
+        } else if (parsed_args.count("record")) {
+            run_record(parsed_args);
+        } else if (parsed_args.count("monitor")) {
+            run_monitor(parsed_args);
+        } else if (parsed_args.count("remap")) {
+            run_remap(parsed_args);
+        } else if (parsed_args.count("replay")) {
+            run_replay(parsed_args);
+        } else if (parsed_args.count("list")) {
             find_gamepads();
+        } else if (parsed_args.count("daemon") && parsed_args.count("output")) {
+            run_daemon(parsed_args);
         } else if (parsed_args.count("output")) {
             make_file_substitution(parsed_args);
         } else {
             std::cout << options->help() << std::endl;
-            exit(1);
+            exit_app(1);
         }
     }
     catch (const cxxopts::OptionException& e)
     {
         std::cout << "error parsing options: " << e.what() << std::endl;
-        exit(1);
+        exit_app(1);
     }
     catch (const MainAppException& e) 
     {
         std::cout << e.what() << std::endl;
-        exit(1);
+        exit_app(1);
     }
 }
 
-void MainApp::make_file_substitution(cxxopts::ParseResult &parsed_args)
+void MainApp::parse_output_args(cxxopts::ParseResult &parsed_args)
 {
-    std::vector<t_uptr_evdevjoystick> gamepads;
-    fs::path arg_tpl_path;
-    fs::path arg_tpl_dir;
-    std::vector<std::string> guid_list;
-    std::vector<std::string> guid_filter;
-
+    guid_select.clear();
+    guid_filter.clear();
     if (parsed_args["guid"].count()) {
-        guid_list = parsed_args["filter-guid"].as<std::vector<std::string>>();
+        guid_select = parse_guid_list(parsed_args["guid"].as<std::vector<std::string>>());
     }
 
     if (parsed_args["filter-guid"].count()) {
-        guid_filter = parsed_args["filter-guid"].as<std::vector<std::string>>();
+        guid_filter = parse_guid_list(parsed_args["filter-guid"].as<std::vector<std::string>>());
     }
 
-    init_gamepads(guid_list, guid_filter, gamepads);
-
-    if (gamepads.size() == 0) {
-        throw MainAppException("There is not connected any gamepad.");
+    if (!parsed_args.count("template")) {
+        throw MainAppException("Template file is not specified (option -t).");
     }
-
-    arg_tpl_path = parsed_args["template"].as<std::string>();
-    if (!fs::exists(arg_tpl_path)) {
-        throw MainAppException("Template file '" + arg_tpl_path.string() + "' does not exist.");
+    std::vector<std::string> tpl_files = parsed_args["template"].as<std::vector<std::string>>();
+    if (tpl_files.size() != 1) {
+        throw MainAppException("Only one template file can be specified (option -t).");
+    }
+    tpl_filename = tpl_files[0];
+    if (!fs::exists(tpl_filename)) {
+        throw MainAppException("Template file '" + tpl_filename + "' does not exist.");
     }
 
     if (parsed_args.count("tdir")) {
-        arg_tpl_dir = parsed_args["tdir"].as<std::string>();
+        tpl_dir = parsed_args["tdir"].as<std::string>();
         
-        if (fs::is_directory(arg_tpl_dir)) {
-            LOG(INFO) << "Specified template directory: " << arg_tpl_dir.string() << "\n"
+        if (fs::is_directory(tpl_dir)) {
+            LOG(INFO) << "Specified template directory: " << tpl_dir << "\n"
                 << "  file will be searched in file: <guid_id>.tpl";
         } else {
-            throw MainAppException("Template directory: '" + arg_tpl_dir.string() + "'does not exist");
+            throw MainAppException("Template directory: '" + tpl_dir + "'does not exist");
         }
     }
 
-    std::string arg_out_filename = parsed_args["output"].as<std::string>();
-    std::vector<std::string> voutput = string::rsplit(arg_out_filename, ".", 1);
-
-    std::string file_name_base = voutput[0];
-    std::string file_ext = "";
+    out_filename = parsed_args["output"].as<std::string>();
+    std::vector<std::string> voutput = string::rsplit(out_filename, ".", 1);
+    out_filename_base = voutput[0];
+    out_filename_ext = "";
 
     if (voutput.size() > 1) {
-        file_ext = voutput[1];
+        out_filename_ext = voutput[1];
+    }
+}
+
+std::string MainApp::get_out_filename(std::size_t index) const
+{
+    if (index == 0) {
+        return out_filename;
     }
+    return out_filename_base + std::to_string(index) + "." + out_filename_ext;
+}
 
-    fs::path tpl_filename;
-    for(int i = 0; i < gamepads.size(); i++) {
-        if (i>0) {
-            arg_out_filename = file_name_base + std::to_string(i) + "." + file_ext;
+const TemplateProgram& MainApp::get_gamepad_template(const evdevjoy::EvdevJoystick &gamepad)
+{
+    if (!tpl_dir.empty()) {
+        fs::path gamepad_tpl = fs::path(tpl_dir) / (gamepad.get_guid().to_string() + ".tpl");
+        if (fs::exists(gamepad_tpl)) {
+            return get_template(gamepad_tpl.string());
         }
+        LOG(INFO) << "Specific template does not exist: " << gamepad_tpl.string();
+    }
+    return get_template(tpl_filename);
+}
 
-        if (!arg_tpl_dir.empty()) {
-            std::string _filename_tpl = gamepads[i]->get_guid() + ".tpl";
-            tpl_filename = arg_tpl_dir / _filename_tpl;
-            if (!fs::exists(tpl_filename)) {
-                LOG(INFO) << "Specific template does not exist: " << tpl_filename.string();
-                tpl_filename = arg_tpl_path;
-            }
-        } else {
-            tpl_filename = arg_tpl_path;
+void MainApp::make_file_substitution(cxxopts::ParseResult &parsed_args)
+{
+    std::vector<t_uptr_evdevjoystick> gamepads;
+
+    parse_output_args(parsed_args);
+    init_gamepads(guid_select, guid_filter, gamepads);
+
+    if (gamepads.size() == 0) {
+        throw MainAppException("There is not connected any gamepad.");
+    }
+
+    // Output file and template of every gamepad, each distinct template
+    // is compiled only once
+    std::vector<std::string> out_filenames(gamepads.size());
+    std::vector<const TemplateProgram*> programs(gamepads.size());
+    for(std::size_t i = 0; i < gamepads.size(); i++) {
+        out_filenames[i] = get_out_filename(i);
+        programs[i] = &get_gamepad_template(*gamepads[i]);
+    }
+
+    // Templates are shared read-only by the worker threads
+    parallel::for_each_index(gamepads.size(), jobs, [&](std::size_t i) {
+        replace_mapping(*gamepads[i], *programs[i], out_filenames[i]);
+    });
+    report_outputs();
+    finish_render_cache();
+}
+
+std::vector<Guid> MainApp::parse_guid_list(const std::vector<std::string> &values)
+{
+    std::vector<Guid> result;
+    Guid guid;
+
+    for (auto const &value : values) {
+        if (value.empty()) {
+            continue;
+        }
+        if (!Guid::from_string(value, guid)) {
+            throw MainAppException("Wrong gamepad guid: '" + value + "'");
         }
-        replace_mapping(*gamepads[i], tpl_filename, arg_out_filename);
+        result.push_back(guid);
     }
+    return result;
+}
+
+bool MainApp::select_gamepad(const Guid &guid_it, const std::vector<Guid> &guid,
+        const std::vector<Guid> &filter)
+{
+    if (guid.size() > 0) {
+        if (std::find(guid.begin(), guid.end(), guid_it) == guid.end()) {
+            LOG(WARNING) << "Skip gamepad, not in the list (option --guid): " << guid_it;
+            return false;
+        }
+    }
+
+    if (std::find(filter.begin(), filter.end(), guid_it) != filter.end()) {
+        LOG(WARNING) << "Filter out gamepad (option --filter-guid): " << guid_it;
+        return false;
+    }
+    return true;
 }
 
 void MainApp::init_gamepads(
-        const std::vector<std::string> &guid,
-        const std::vector<std::string> &filter,
+        const std::vector<Guid> &guid,
+        const std::vector<Guid> &filter,
         std::vector<t_uptr_evdevjoystick> &gamepads)
 {
-    std::vector<std::string> ev_devices = EvdevJoystick::get_event_devices();
-    std::string guid_it;
-    bool match_guid;
+    std::vector<t_uptr_evdevjoystick> devices = open_gamepads();
+    std::vector<Guid> connected_guids;
 
-    for(auto path : ev_devices) {
-        auto tmp_gamepad = std::make_unique<evdevjoy::EvdevJoystick>(path);
-        guid_it = tmp_gamepad->get_guid();
+    for(auto &tmp_gamepad : devices) {
+        if (!tmp_gamepad) {
+            continue;
+        }
+        if (select_gamepad(tmp_gamepad->get_guid(), guid, filter)) {
+            connected_guids.push_back(tmp_gamepad->get_guid());
+            gamepads.push_back(std::move(tmp_gamepad));
+        }
+    }
+
+    if (gamepads.empty()) {
+        return;
+    }
+
+    // Parse only mappings of the connected gamepads
+    joymap.set_guid_filter(connected_guids);
+    load_mapping_db();
+    for (auto &gamepad : gamepads) {
+        gamepad->set_mapping(joymap);
+    }
+}
+
+void MainApp::load_mapping_db()
+{
+    joymap.add_default_mapping();
+    for (auto const &filename : db_files) {
+        try {
+            joymap.add_mapping_file(filename);
+        } catch (const std::runtime_error &e) {
+            throw MainAppException(e.what());
+        }
+    }
+}
 
-        match_guid = true;
-        if (guid.size() > 0) {
-            if (std::find(guid.begin(), guid.end(), guid_it) == guid.end()) {
-                LOG(WARNING) << "Skip gamepad, not in the list (option --guid): " << guid_it;
-                match_guid = false;
+void MainApp::compile_db(const std::string &in_filename, const std::string &out_filename)
+{
+    std::ifstream fin(in_filename, std::ios::in);
+    if (!fin) {
+        throw MainAppException("Cannot open mapping database '" + in_filename + "'");
+    }
+
+    std::ofstream fout(out_filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!fout) {
+        throw MainAppException("Cannot create file '" + out_filename + "'");
+    }
+
+    std::size_t n_mappings = BinaryMappingDb::compile(fin, fout);
+    fout.close();
+    if (!fout) {
+        throw MainAppException("Error during writing file '" + out_filename + "'");
+    }
+    std::cout << "Compiled " << n_mappings << " mappings into " << out_filename << std::endl;
+}
+
+std::vector<t_uptr_evdevjoystick> MainApp::open_gamepads()
+{
+    if (!snapshot_files.empty()) {
+        std::vector<t_uptr_evdevjoystick> devices;
+        try {
+            for (auto const &filename : snapshot_files) {
+                for (auto const &descriptor : read_snapshot_file(filename)) {
+                    devices.push_back(std::make_unique<EvdevJoystick>(descriptor));
+                }
             }
+        } catch (const std::runtime_error &e) {
+            throw MainAppException(e.what());
         }
+        return devices;
+    }
+    if (!sysfs_root.empty()) {
+        std::vector<t_uptr_evdevjoystick> devices;
+        try {
+            for (auto const &descriptor : SysfsInput(sysfs_root, dev_root).get_joysticks()) {
+                devices.push_back(std::make_unique<EvdevJoystick>(descriptor));
+            }
+        } catch (const std::runtime_error &e) {
+            throw MainAppException(e.what());
+        }
+        return devices;
+    }
+    return probe_devices(EvdevJoystick::get_event_devices());
+}
 
-        if (std::find(filter.begin(), filter.end(), guid_it) != filter.end()) {
-            match_guid = false;
-            LOG(WARNING) << "Filter out gamepad (option --filter-guid): " << guid_it;
+std::vector<t_uptr_evdevjoystick> MainApp::probe_devices(const std::vector<std::string> &devnames)
+{
+    if (probe_cache_file.empty()) {
+        return EvdevJoystick::open_devices(devnames, probe_timeout);
+    }
+    if (!probe_cache) {
+        probe_cache = std::make_unique<ProbeCache>(probe_cache_file);
+        probe_cache->load();
+    }
+
+    // Devices with valid cache entry are not opened
+    SysfsInput sysfs;
+    std::vector<t_uptr_evdevjoystick> devices(devnames.size());
+    std::vector<std::string> probe_devnames;
+    std::vector<std::size_t> probe_index;
+    for (std::size_t i=0; i < devnames.size(); i++) {
+        DeviceDescriptor descriptor;
+        if (probe_cache->find(sysfs, devnames[i], descriptor)) {
+            LOG(INFO) << "Device found in probe cache: " << devnames[i];
+            devices[i] = std::make_unique<EvdevJoystick>(descriptor);
+        } else {
+            probe_devnames.push_back(devnames[i]);
+            probe_index.push_back(i);
         }
+    }
 
-        if (match_guid) {
-            tmp_gamepad->set_mapping(joymap);
-            gamepads.push_back(std::move(tmp_gamepad));
+    std::vector<t_uptr_evdevjoystick> probed = EvdevJoystick::open_devices(probe_devnames, probe_timeout);
+    for (std::size_t i=0; i < probed.size(); i++) {
+        if (probed[i]) {
+            probe_cache->insert(probed[i]->get_descriptor());
         }
+        devices[probe_index[i]] = std::move(probed[i]);
     }
+
+    if (probe_cache->is_modified()) {
+        try {
+            probe_cache->save();
+        } catch (const std::system_error &e) {
+            LOG(WARNING) << "Cannot save probe cache: " << e.what();
+        }
+    }
+    return devices;
 }
 
-void MainApp::find_gamepads()
+t_uptr_evdevjoystick MainApp::open_gamepad(const std::string &devname)
 {
-    std::vector<std::string> ev_devices = EvdevJoystick::get_event_devices();
+    if (!sysfs_root.empty()) {
+        try {
+            for (auto const &descriptor : SysfsInput(sysfs_root, dev_root).get_joysticks()) {
+                if (descriptor.devname == devname) {
+                    return std::make_unique<EvdevJoystick>(descriptor);
+                }
+            }
+        } catch (const std::runtime_error &e) {
+            LOG(WARNING) << "Skip device " << devname << ": " << e.what();
+            return nullptr;
+        }
+        LOG(WARNING) << "Skip device " << devname << ": not found in " << sysfs_root;
+        return nullptr;
+    }
+    return std::move(probe_devices({devname}).front());
+}
 
-    for(auto path : ev_devices) {
-        EvdevJoystick joy(path);
-        std::cout << joy.get_guid()
-            << "\t" << joy.get_name() 
-            << "\t" << path
+void MainApp::save_snapshot(const std::string &filename)
+{
+    std::vector<t_uptr_evdevjoystick> gamepads = open_gamepads();
+    try {
+        write_snapshot_file(filename, gamepads);
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+    std::size_t n_gamepads = std::count_if(gamepads.begin(), gamepads.end(),
+        [](const t_uptr_evdevjoystick &gamepad) { return bool(gamepad); });
+    std::cout << "Saved " << n_gamepads << " gamepads into " << filename << std::endl;
+}
+
+void MainApp::find_gamepads()
+{
+    for(auto &joy : open_gamepads()) {
+        if (!joy) {
+            continue;
+        }
+        std::cout << joy->get_guid()
+            << "\t" << joy->get_name() 
+            << "\t" << joy->devname
             << std::endl;
     }
 }
 
-void MainApp::replace_mapping(evdevjoy::EvdevJoystick &gamepad, const std::string &tpl_filename, 
-        const std::string &out_filename)
+const TemplateProgram& MainApp::get_template(const std::string &tpl_filename)
+{
+    auto it = templates.find(tpl_filename);
+    if (it != templates.end()) {
+        return it->second;
+    }
+
+    LOG(INFO) << "Compile template: " << tpl_filename;
+    try {
+        return templates.emplace(tpl_filename, TemplateProgram::compile_file(tpl_filename)).first->second;
+    } catch (const std::system_error &e) {
+        throw MainAppException(e.what());
+    }
+}
+
+bool MainApp::replace_mapping(const evdevjoy::EvdevJoystick &gamepad, const TemplateProgram &program, 
+        const std::string &out_filename) const
 {
     LOG(INFO) << "replace_mapping\n"
-        << "  template: " << tpl_filename << "\n"
+        << "  gamepad: " << gamepad.devname << "\n"
         << "  output file: " << out_filename;
 
-    std::ifstream fin;
-    std::ofstream fout;
+    std::string cache_key;
+    std::string cached;
+    if (render_cache) {
+        cache_key = RenderCache::make_key(program, gamepad);
+        cached = render_cache->find(cache_key);
+    }
 
-    fin.exceptions(std::ifstream::badbit);
-    fout.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    // Unchanged parts of the template are written directly from the mapped file
+    platform::IovecBuffer output;
+    platform::FileUpdate result = platform::FileUpdate::UNCHANGED;
     try {
-        fin.open(tpl_filename, std::ios::in);
-        fout.open(out_filename, std::ios::out | std::ios::trunc);
-        sreplace_mapping(gamepad, fin, fout);
+        if (!cached.empty()) {
+            try {
+                result = platform::update_file_from(out_filename, cached);
+                LOG(INFO) << "  copied from render cache: " << cache_key;
+            } catch (const std::system_error &e) {
+                LOG(WARNING) << "  render cache entry " << cache_key << " not copied, "
+                    << "the template is rendered: " << e.what();
+                render_cache->lost_hit();
+                cached.clear();
+            }
+        }
+        if (cached.empty()) {
+            program.render(gamepad, output);
+            result = platform::update_file(out_filename, output);
+        }
     }
-    catch (const std::ios_base::failure& e) {
-        LOG(ERROR) << "Error during opening file (errorcode: " << e.code()  << ")\n"
+    catch (const std::system_error& e) {
+        LOG(ERROR) << "Error during writing file (errorcode: " << e.code()  << ")\n"
             << e.what() << std::endl;
+        return false;
+    }
+    if (render_cache && cached.empty()) {
+        render_cache->store(cache_key, output);
     }
 
+    switch (result) {
+        case platform::FileUpdate::UNCHANGED:
+            LOG(INFO) << "  output unchanged";
+            output_stats.unchanged++;
+            break;
+        case platform::FileUpdate::REWRITTEN:
+            output_stats.rewritten++;
+            break;
+        case platform::FileUpdate::CREATED:
+            output_stats.created++;
+            break;
+    }
+    return true;
+}
 
+void MainApp::report_outputs() const
+{
+    std::cout << "Outputs: " << output_stats.unchanged << " unchanged, " 
+        << output_stats.rewritten << " rewritten, " << output_stats.created << " new" << std::endl;
 }
 
-void MainApp::sreplace_mapping(evdevjoy::EvdevJoystick &gamepad, std::istream &is, std::ostream &os)
-{
-    std::string line;
-    std::string result_line;
-    std::string::size_type i_cmd_start, i_cmd_end, i_start;
-    std::string command;
-    std::string mapped_value;
-    bool unsupported;
-    e_mapping_result mapping_result;
-
-    while (std::getline(is, line)) {
-        result_line.clear();
-        i_cmd_start = 0;
-        i_start = 0;
-        unsupported = false;
-
-        while ((i_cmd_start=line.find("<", i_start)) != std::string::npos)
-        {
-            i_cmd_end = line.find(">", i_cmd_start + 1);
-            if (i_cmd_end != std::string::npos) {
-                command = line.substr(i_cmd_start+1, i_cmd_end-i_cmd_start-1);
-                result_line.append(line, i_start, i_cmd_start);
-                
-                mapping_result = get_mapping_value(gamepad, command, mapped_value);
-                if (mapping_result == e_mapping_result::FOUND) {
-                    result_line.append(mapped_value);
-                } else if (mapping_result == e_mapping_result::NOT_FOUND) {
-                    result_line.append(line, i_cmd_start, i_cmd_end-i_cmd_start+1);
-                } else if (mapping_result == e_mapping_result::UNSUPPORTED) {
-                    result_line.append(mapped_value);
-                    unsupported = true;
-                }
-                i_start = i_cmd_end + 1;
-            } else {
-                result_line.append(line, i_start, std::string::npos);
-                break;
-            }
+void MainApp::finish_render_cache()
+{
+    if (!render_cache) {
+        return;
+    }
+    LOG(INFO) << "Render cache: " << render_cache->get_hits() << " hits, " 
+        << render_cache->get_misses() << " misses";
+    render_cache->evict();
+}
+
+void MainApp::run_fleet(cxxopts::ParseResult &parsed_args)
+{
+    fs::path out_dir = parsed_args["fleet"].as<std::string>();
+    if (!parsed_args.count("template")) {
+        throw MainAppException("Template file is not specified (option -t).");
+    }
+    std::vector<std::string> tpl_files = parsed_args["template"].as<std::vector<std::string>>();
+    if (parsed_args["guid"].count()) {
+        guid_select = parse_guid_list(parsed_args["guid"].as<std::vector<std::string>>());
+    }
+    if (parsed_args["filter-guid"].count()) {
+        guid_filter = parse_guid_list(parsed_args["filter-guid"].as<std::vector<std::string>>());
+    }
+
+    // Output <template name>.conf of every template
+    std::vector<const TemplateProgram*> programs;
+    std::vector<std::string> out_names;
+    for (auto const &filename : tpl_files) {
+        std::string out_name = fs::path(filename).stem().string() + ".conf";
+        if (std::find(out_names.begin(), out_names.end(), out_name) != out_names.end()) {
+            throw MainAppException("Two templates with the same name: " + out_name);
         }
+        programs.push_back(&get_template(filename));
+        out_names.push_back(out_name);
+    }
 
-        result_line.append(line, i_start, std::string::npos);
-        if (unsupported) {
-            if (result_line.size() > 0) {
-                os << "# " << result_line << "\n";
+    // Only the listed mappings are parsed from the text databases
+    joymap.set_guid_filter(guid_select);
+    load_mapping_db();
+    std::vector<Guid> guids = guid_select.empty() ? joymap.get_guids() : guid_select;
+
+    // Mappings are resolved before rendering, get_mapping() is not thread safe
+    std::vector<std::pair<Guid, const ControllerMapping*>> mappings;
+    mappings.reserve(guids.size());
+    for (auto const &guid : guids) {
+        if (std::find(guid_filter.begin(), guid_filter.end(), guid) != guid_filter.end()) {
+            continue;
+        }
+        const ControllerMapping *mapping = joymap.get_mapping(guid);
+        if (mapping == nullptr) {
+            LOG(WARNING) << "Skip guid, no mapping: " << guid;
+            continue;
+        }
+        mappings.emplace_back(guid, mapping);
+    }
+
+    std::error_code ec;
+    fs::create_directories(out_dir, ec);
+    if (ec) {
+        throw MainAppException("Cannot create directory '" + out_dir.string() + "': " + ec.message());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<std::size_t> n_failed{0};
+    parallel::for_each_index(mappings.size(), jobs, [&](std::size_t i) {
+        const Guid &guid = mappings[i].first;
+        EvdevJoystick gamepad(make_device_layout(guid, *mappings[i].second));
+        gamepad.set_mapping(*mappings[i].second);
+
+        fs::path guid_dir = out_dir / guid.to_string();
+        std::error_code dir_ec;
+        fs::create_directory(guid_dir, dir_ec);
+        for (std::size_t t=0; t < programs.size(); t++) {
+            if (!replace_mapping(gamepad, *programs[t], (guid_dir / out_names[t]).string())) {
+                n_failed++;
             }
-        } else {
-            os << result_line << "\n";
         }
+    });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::size_t n_outputs = mappings.size() * programs.size() - n_failed;
+    std::cout << "Rendered " << n_outputs << " outputs for " << mappings.size() 
+        << " mappings in " << elapsed.count() << " s ("
+        << static_cast<uint64_t>(n_outputs / std::max(elapsed.count(), 1e-9)) << " outputs/s)";
+    if (n_failed > 0) {
+        std::cout << ", " << n_failed << " failed";
+    }
+    if (render_cache) {
+        std::cout << ", " << render_cache->get_hits() << " from render cache";
+    }
+    std::cout << std::endl;
+    report_outputs();
+    finish_render_cache();
+}
+
+// Set by SIGINT and SIGTERM, stops run_engine()
+static volatile sig_atomic_t s_stop_engine = 0;
+
+static void stop_engine_handler(int)
+{
+    s_stop_engine = 1;
+}
+
+static void install_stop_handler()
+{
+    // epoll_wait() and clock_nanosleep() are interrupted by the signal
+    struct sigaction action = {};
+    action.sa_handler = stop_engine_handler;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+static void print_engine_gamepad(std::size_t index, const EvdevJoystick &gamepad)
+{
+    std::cout << "Gamepad " << index << ": " << gamepad.get_guid() << "\t" 
+        << gamepad.get_name() << "\t" << gamepad.devname << std::endl;
+}
+
+std::vector<t_uptr_evdevjoystick> MainApp::open_engine_gamepads(cxxopts::ParseResult &parsed_args)
+{
+    std::vector<Guid> guid;
+    std::vector<Guid> filter;
+    if (parsed_args["guid"].count()) {
+        guid = parse_guid_list(parsed_args["guid"].as<std::vector<std::string>>());
+    }
+    if (parsed_args["filter-guid"].count()) {
+        filter = parse_guid_list(parsed_args["filter-guid"].as<std::vector<std::string>>());
+    }
+    if (!sysfs_root.empty() || !snapshot_files.empty()) {
+        throw MainAppException("Options --monitor, --remap and --record need the event "
+            "devices, not --sysfs or --from-snapshot.");
+    }
+    // Cached gamepads are not opened
+    probe_cache_file.clear();
 
+    std::vector<t_uptr_evdevjoystick> gamepads;
+    init_gamepads(guid, filter, gamepads);
+    if (gamepads.empty()) {
+        throw MainAppException("There is not connected any gamepad.");
     }
+    return gamepads;
 }
-#if 0
-void MainApp::sreplace_mapping(evdevjoy::EvdevJoystick &gamepad, std::istream &is, std::ostream &os)
-{
-    std::streambuf *osbuf = os.rdbuf();
-    char buffer[BUFFER_SIZE];
-    e_mapping_result mapping_result;
-    std::string mapped_value;
-
-    while (is.get(*osbuf, '<').good()) {
-        mapping_result = false;
-        is.get(buffer, BUFFER_SIZE, '>');
-
-        if (is.gcount() < BUFFER_SIZE) {
-            mapping_result = get_mapping_value(
-                gamepad,
-                std::string_view(buffer+1, is.gcount()-1),
-                mapped_value);
-
-            if (mapping_result) {
-                os << mapped_value;
-                is.ignore(1); // Skip right angle bracket
-            }
-        } 
-        
-        if (!mapping_result && (is.gcount() > 0))  { 
-            os.write(buffer, is.gcount());
+
+std::unique_ptr<EventMonitor> MainApp::open_event_monitor(cxxopts::ParseResult &parsed_args)
+{
+    std::vector<t_uptr_evdevjoystick> gamepads = open_engine_gamepads(parsed_args);
+    std::unique_ptr<EventMonitor> monitor;
+    try {
+        monitor = std::make_unique<EventMonitor>();
+    } catch (const std::system_error &e) {
+        throw MainAppException(e.what());
+    }
+    // engine_gamepads have the indexes of the monitor
+    for (auto &gamepad : gamepads) {
+        std::size_t index;
+        try {
+            index = monitor->add(*gamepad);
+        } catch (const std::runtime_error &e) {
+            LOG(WARNING) << "Gamepad is not monitored: " << e.what();
+            continue;
         }
-        std::cout << "loop: " << buffer << "count = "<< is.gcount() << std::endl;
+        print_engine_gamepad(index, *gamepad);
+        engine_gamepads.push_back(std::move(gamepad));
+    }
+    if (monitor->size() == 0) {
+        throw MainAppException("There is not connected any gamepad.");
     }
+    return monitor;
+}
 
+void MainApp::run_event_loop(EventMonitor &monitor, EventHandler &handler)
+{
+    install_stop_handler();
+    while ((monitor.size() > 0) && !s_stop_engine) {
+        try {
+            monitor.read_events(handler);
+        } catch (const std::system_error &e) {
+            throw MainAppException(e.what());
+        }
+    }
+    const EventMonitor::Stats &stats = monitor.get_stats();
+    LOG(INFO) << "EventMonitor: " << stats.events << " events, " << stats.frames << " frames, "
+        << stats.reads << " reads, " << stats.drops << " drops";
 }
 
-#endif
+const LatencyStats& MainApp::run_engine(cxxopts::ParseResult &parsed_args, EventSink &sink)
+{
+    if (!replay_file.empty()) {
+        return replay_engine(sink);
+    }
+
+    if (threaded) {
+        return run_pipeline(parsed_args, sink);
+    }
 
-MainApp::e_mapping_result MainApp::map_evdev(evdevjoy::EvdevJoystick &gamepad, std::string &result)
-{
-    result = gamepad.devname;
-    return e_mapping_result::FOUND;
-}
-
-MainApp::e_mapping_result MainApp::map_abs(evdevjoy::EvdevJoystick &gamepad, 
-        std::string_view button_name, std::string &result)
-{
-    std::string button_name_lower = string::lower(button_name);
-    t_MapButton2SDLButton::const_iterator it = MapButton2SDLButton.find(button_name_lower);
-    e_mapping_result retvalue = e_mapping_result::UNSUPPORTED;
-    
-    if (it != MapButton2SDLButton.end()) {
-        EventButtonBinding event_binding = gamepad.get_event_binding(it->second);
-        if (event_binding) {
-            if ( (event_binding.bind->input_type == BindType::BINDTYPE_AXIS) || 
-                 (event_binding.bind->input_type == BindType::BINDTYPE_HAT)) {
-                result = event_binding.event->get_name();
-                retvalue = e_mapping_result::FOUND;
-            } else {
-                LOG(WARNING) << "MAP_BUTTON: Error to map: " << button_name << "\n"
-                    << "  button must be of the type axis or hat only";
-                result = "ERROR ";
-                result.append(event_binding.event->get_name());
-                result.append(" is button"); 
-                retvalue = e_mapping_result::UNSUPPORTED;
+    engine_monitor = open_event_monitor(parsed_args);
+    engine = std::make_unique<RemapEngine>(sink);
+    // Failed sink is fatal
+    try {
+        for (auto const &gamepad : engine_gamepads) {
+            engine->add(*gamepad);
+        }
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+    run_event_loop(*engine_monitor, *engine);
+    return engine->get_latency();
+}
+
+const LatencyStats& MainApp::run_pipeline(cxxopts::ParseResult &parsed_args, EventSink &sink)
+{
+    // Every gamepad is watched by the monitor of its reader thread
+    std::vector<t_uptr_evdevjoystick> gamepads = open_engine_gamepads(parsed_args);
+    try {
+        pipeline = std::make_unique<RemapPipeline>(sink, ring_frames);
+        for (auto &gamepad : gamepads) {
+            if (pipeline->add(*gamepad)) {
+                print_engine_gamepad(engine_gamepads.size(), *gamepad);
+                engine_gamepads.push_back(std::move(gamepad));
             }
-        } else {
-            LOG(ERROR) << "Unsupported gamepad button: " << button_name;
-            result = "Unsupported gamepad mapping: ";
-            result.append(button_name);  
-            retvalue = e_mapping_result::UNSUPPORTED;
         }
-    } else {
-        LOG(ERROR) << "Cannot find button mapping for: " << button_name;
-        result = "Unknown button: ";
-        result.append(button_name);
-        retvalue = e_mapping_result::UNSUPPORTED;
-    }
-
-    return retvalue;
-}
-
-
-MainApp::e_mapping_result MainApp::map_button(evdevjoy::EvdevJoystick &gamepad, 
-        std::string_view button_name, std::string &result)
-{
-    std::string button_name_lower = string::lower(button_name);
-    t_MapButton2SDLButton::const_iterator it = MapButton2SDLButton.find(button_name_lower);
-    e_mapping_result retvalue = e_mapping_result::UNSUPPORTED;
-    
-    result.clear();
-    if (it != MapButton2SDLButton.end()) {
-        EventButtonBinding event_binding = gamepad.get_event_binding(it->second);
-        if (event_binding) {
-            if (event_binding.bind->input_type == BindType::BINDTYPE_BUTTON) {
-                result = event_binding.event->get_name();
-                retvalue = e_mapping_result::FOUND;
-            } else {
-                LOG(WARNING) << "MAP_BUTTON: Error to map: " << button_name << "\n"
-                    << "  button must be of the type button only (not hat, or axes)";
-                result = "ERROR ";
-                result.append(event_binding.event->get_name());
-                result.append(" is axes"); 
-                retvalue = e_mapping_result::UNSUPPORTED;
-            } 
-        } else {
-            LOG(ERROR) << "Unsupported gamepad button: " << button_name;
-            result = "Unsupported gamepad mapping: ";
-            result.append(button_name);  
-            retvalue = e_mapping_result::UNSUPPORTED;
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+    if (engine_gamepads.empty()) {
+        throw MainAppException("There is not connected any gamepad.");
+    }
+
+    pipeline->start();
+    install_stop_handler();
+    while ((pipeline->size() > 0) && !s_stop_engine) {
+        try {
+            pipeline->process();
+        } catch (const std::system_error &e) {
+            throw MainAppException(e.what());
         }
-    } else {
-        LOG(ERROR) << "Cannot find button mapping for: " << button_name;
-        result = "Unknown button: ";
-        result.append(button_name);
-        retvalue = e_mapping_result::UNSUPPORTED;
     }
+    pipeline->stop();
+    for (std::size_t i=0; i < engine_gamepads.size(); i++) {
+        RemapPipeline::RingStats stats = pipeline->get_ring_stats(i);
+        LOG(INFO) << "RemapPipeline: gamepad " << i << " " << stats.frames << " frames, "
+            << stats.drops << " drops, max occupancy " << stats.max_occupancy 
+            << "/" << stats.capacity;
+    }
+    return pipeline->get_latency();
+}
+
+const LatencyStats& MainApp::replay_engine(EventSink &sink)
+{
+    std::unique_ptr<TraceReader> reader;
+    try {
+        reader = std::make_unique<TraceReader>(replay_file);
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+    if (reader->get_devices().empty()) {
+        throw MainAppException("There is not any gamepad in trace '" + replay_file + "'");
+    }
+
+    // All gamepads of the trace, the index is the trace device
+    std::vector<Guid> trace_guids;
+    for (auto const &device : reader->get_devices()) {
+        engine_gamepads.push_back(std::make_unique<EvdevJoystick>(device.descriptor));
+        trace_guids.push_back(engine_gamepads.back()->get_guid());
+    }
+    joymap.set_guid_filter(trace_guids);
+    load_mapping_db();
 
-    return retvalue;
+    engine = std::make_unique<RemapEngine>(sink);
+    try {
+        for (std::size_t i=0; i < engine_gamepads.size(); i++) {
+            EvdevJoystick &gamepad = *engine_gamepads[i];
+            gamepad.set_mapping(joymap);
+            engine->add(gamepad);
+            // Ranges of the recorded device
+            const TraceDevice &device = reader->get_devices()[i];
+            device.descriptor.abs_bits.for_each(0, ABS_CNT, [&](std::size_t code) {
+                engine->get_table(i).set_abs_info(code, device.abs_info[code]);
+            });
+            print_engine_gamepad(i, gamepad);
+        }
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+
+    install_stop_handler();
+    TraceReplay replay(*reader, replay_speed);
+    auto start = high_resolution_clock::now();
+    try {
+        while (!s_stop_engine && replay.play_frame(*engine)) {
+        }
+    } catch (const std::system_error &e) {
+        throw MainAppException(e.what());
+    }
+    std::chrono::duration<double> elapsed = high_resolution_clock::now() - start;
+    std::cout << "Replayed " << replay.get_position() << " events in " 
+        << elapsed.count() << " s (" 
+        << static_cast<uint64_t>(replay.get_position() / std::max(elapsed.count(), 1e-9))
+        << " events/s)" << std::endl;
+    return engine->get_latency();
 }
 
-MainApp::e_mapping_result MainApp::axismap(evdevjoy::EvdevJoystick &gamepad,
-        std::string_view button_name, std::string &result)
+void MainApp::run_monitor(cxxopts::ParseResult &parsed_args)
 {
-    e_mapping_result retvalue = e_mapping_result::UNSUPPORTED;
+    StreamSink sink(std::cout);
+    run_engine(parsed_args, sink);
+}
 
-    if (button_name.size() < 2) {
-        result = "Wrong axis name: ";
-        result.append(button_name);
-        return e_mapping_result::UNSUPPORTED;
+void MainApp::run_remap(cxxopts::ParseResult &parsed_args)
+{
+    UinputSink sink;
+    const LatencyStats &latency = run_engine(parsed_args, sink);
+    latency.print(std::cout);
+    if (engine_monitor) {
+        const EventMonitor::Stats &stats = engine_monitor->get_stats();
+        std::cout << "Read " << stats.events << " events in " << stats.frames << " frames, "
+            << stats.reads << " read calls (" 
+            << double(stats.reads) / std::max<uint64_t>(stats.frames, 1) << " per frame), "
+            << stats.drops << " drops" << std::endl;
+    }
+    if (pipeline) {
+        for (std::size_t i=0; i < engine_gamepads.size(); i++) {
+            RemapPipeline::RingStats stats = pipeline->get_ring_stats(i);
+            std::cout << "Gamepad " << i << " ring: " << stats.frames << " frames, " 
+                << stats.drops << " drops, max occupancy " << stats.max_occupancy 
+                << "/" << stats.capacity << std::endl;
+        }
     }
+}
+
+void MainApp::run_record(cxxopts::ParseResult &parsed_args)
+{
+    std::string filename = parsed_args["record"].as<std::string>();
+    std::unique_ptr<EventMonitor> monitor = open_event_monitor(parsed_args);
 
-    bool invert_axis = false;
-    
-    if (button_name[0] == '+') {
-        button_name.remove_prefix(1);
-    } else if (button_name[0] == '-') {
-        invert_axis = !invert_axis;
-        button_name.remove_prefix(1);
+    std::vector<const EvdevJoystick*> gamepads;
+    for (auto const &gamepad : engine_gamepads) {
+        gamepads.push_back(gamepad.get());
     }
-    
-    std::string button_name_lower = string::lower(button_name);
-    t_MapButton2SDLButton::const_iterator it = MapButton2SDLButton.find(button_name_lower);
-    if (it != MapButton2SDLButton.end()) {
-        EventButtonBinding event_binding = gamepad.get_event_binding(it->second);
-        if (event_binding) {
-            if (event_binding.bind->input_type == BindType::BINDTYPE_AXIS) {
-                if (event_binding.bind->output_type == BindType::BINDTYPE_AXIS) {
-                    if (event_binding.bind->output.axis_type == ControllerAxisType::HALF_AXIS_NEGATIVE) {
-                        invert_axis = !invert_axis;
-                    }
-                }
-                if (event_binding.bind->input.invert_input) {
-                    invert_axis = !invert_axis;
-                }
-                retvalue = e_mapping_result::FOUND;
-            } else if ((event_binding.bind->input_type == BindType::BINDTYPE_HAT) && 
-                    (event_binding.bind->output_type == BindType::BINDTYPE_BUTTON)) {
-                if ( (event_binding.bind->output.button == ControllerButton::BUTTON_DPAD_LEFT) && 
-                    (event_binding.bind->input.hat_mask == HatMask::RIGHT)) {
-                        invert_axis = !invert_axis;
-                } else if ( (event_binding.bind->output.button == ControllerButton::BUTTON_DPAD_RIGHT) && 
-                    (event_binding.bind->input.hat_mask == HatMask::LEFT)) {
-                        invert_axis = !invert_axis;
-                } else if ( (event_binding.bind->output.button == ControllerButton::BUTTON_DPAD_UP) && 
-                    (event_binding.bind->input.hat_mask == HatMask::DOWN)) {
-                        invert_axis = !invert_axis;
-                } else if ( (event_binding.bind->output.button == ControllerButton::BUTTON_DPAD_DOWN) && 
-                    (event_binding.bind->input.hat_mask == HatMask::UP)) {
-                        invert_axis = !invert_axis;
-                }
-                retvalue = e_mapping_result::FOUND;
-            }
-            
-            if (retvalue == e_mapping_result::FOUND) {
-                if (invert_axis) {
-                    result.clear();
-                    result.append("-");
-                    result.append(button_name);
-                } else {
-                    result = button_name;
-                }
-            } else {
-                LOG(ERROR) << "MAPAXIS: Unsupported mapping for: " << button_name << "\n"
-                    << "Only axes or hats can be mapped.";
-                result = button_name;
+    std::unique_ptr<TraceWriter> writer;
+    try {
+        writer = std::make_unique<TraceWriter>(filename, gamepads);
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+    run_event_loop(*monitor, *writer);
+    try {
+        writer->close();
+    } catch (const std::runtime_error &e) {
+        throw MainAppException(e.what());
+    }
+    std::cout << "Recorded " << writer->get_event_count() << " events of " 
+        << gamepads.size() << " gamepads into " << filename << std::endl;
+}
+
+void MainApp::run_replay(cxxopts::ParseResult &parsed_args)
+{
+    NullSink sink;
+    const LatencyStats &latency = run_engine(parsed_args, sink);
+    std::cout << "Output: " << sink.n_events << " events in " << sink.n_frames 
+        << " frames" << std::endl;
+    latency.print(std::cout);
+}
+
+void MainApp::run_daemon(cxxopts::ParseResult &parsed_args)
+{
+    parse_output_args(parsed_args);
+
+    // Gamepads are not known in advance, all mappings are loaded
+    joymap.set_guid_filter({});
+    load_mapping_db();
+
+    std::unique_ptr<HotplugMonitor> monitor;
+    try {
+        monitor = std::make_unique<HotplugMonitor>(dev_root);
+    } catch (const std::system_error &e) {
+        throw MainAppException(e.what());
+    }
+    LOG(INFO) << "Daemon started, waiting for gamepads";
+
+    std::vector<HotplugMonitor::Event> events{{HotplugMonitor::Action::RESCAN, ""}};
+    while (true) {
+        for (auto const &event : events) {
+            switch (event.action) {
+                case HotplugMonitor::Action::ADD:
+                    daemon_add(event.devname);
+                    break;
+                case HotplugMonitor::Action::REMOVE:
+                    daemon_remove(event.devname);
+                    break;
+                case HotplugMonitor::Action::RESCAN:
+                    daemon_rescan(monitor->get_devices());
+                    break;
             }
+        }
+        events.clear();
+        try {
+            monitor->read_events(events);
+        } catch (const std::system_error &e) {
+            throw MainAppException(e.what());
+        }
+    }
+}
 
-        } else {
-            LOG(ERROR) << "Unsupported gamepad button: " << button_name;
-            result = "Unsupported gamepad mapping: ";
-            result.append(button_name);  
-            retvalue = e_mapping_result::UNSUPPORTED;
+void MainApp::daemon_add(const std::string &devname)
+{
+    t_uptr_evdevjoystick gamepad = open_gamepad(devname);
+    if (!gamepad) {
+        return;
+    }
+
+    auto it = daemon_gamepads.find(devname);
+    if (it != daemon_gamepads.end()) {
+        if (it->second.guid == gamepad->get_guid()) {
+            LOG(INFO) << "Gamepad unchanged, output is not rewritten: " << devname;
+            return;
         }
+        daemon_remove(devname);
+    }
+
+    if (!select_gamepad(gamepad->get_guid(), guid_select, guid_filter)) {
+        return;
+    }
+    gamepad->set_mapping(joymap);
+
+    // The first free output file, numbers of other gamepads are kept
+    std::size_t slot = std::find(daemon_slots.begin(), daemon_slots.end(), false) 
+        - daemon_slots.begin();
+    if (slot == daemon_slots.size()) {
+        daemon_slots.push_back(true);
     } else {
-        LOG(ERROR) << "Cannot find button mapping for: " << button_name;
-        result = "Unknown button: ";
-        result.append(button_name);
-        retvalue = e_mapping_result::UNSUPPORTED;
+        daemon_slots[slot] = true;
     }
-    return retvalue;
+
+    DaemonGamepad &entry = daemon_gamepads[devname];
+    entry.guid = gamepad->get_guid();
+    entry.slot = slot;
+    entry.out_filename = get_out_filename(slot);
+    try {
+        replace_mapping(*gamepad, get_gamepad_template(*gamepad), entry.out_filename);
+    } catch (const MainAppException &e) {
+        LOG(ERROR) << "Cannot render output of " << devname << ": " << e.what();
+    }
+    finish_render_cache();
+    LOG(INFO) << "Gamepad connected: " << entry.guid << " " << devname 
+        << " -> " << entry.out_filename;
 }
 
-MainApp::e_mapping_result MainApp::get_mapping_value(evdevjoy::EvdevJoystick &gamepad, 
-    std::string_view map_command, std::string &result)
+void MainApp::daemon_remove(const std::string &devname)
 {
-    std::vector<std::string_view> cmd_args = string::split(
-        map_command, std::string(":"), 1);
-    
-    result.clear();
+    auto it = daemon_gamepads.find(devname);
+    if (it == daemon_gamepads.end()) {
+        return;
+    }
 
-    if (cmd_args.size() == 1) {
-        if (cmd_args[0] == "MAP_EVDEV") {
-            return map_evdev(gamepad, result);
-        }
-    } else if (cmd_args.size() == 2) {
-        if (cmd_args[0] == "MAP_ABS") {
-            return map_abs(gamepad, cmd_args[1], result);
-        } else if (cmd_args[0] == "MAP_BUTTON") {
-            return map_button(gamepad, cmd_args[1], result);
-        } else if (cmd_args[0] == "AXISMAP") {
-            return axismap(gamepad, cmd_args[1], result);
-        } 
-    } 
+    std::error_code ec;
+    if (!fs::remove(it->second.out_filename, ec) && ec) {
+        LOG(WARNING) << "Cannot remove " << it->second.out_filename << ": " << ec.message();
+    }
+    LOG(INFO) << "Gamepad disconnected: " << it->second.guid << " " << devname
+        << ", removed " << it->second.out_filename;
+    daemon_slots[it->second.slot] = false;
+    daemon_gamepads.erase(it);
+}
 
-    return e_mapping_result::NOT_FOUND;
+void MainApp::daemon_rescan(const std::vector<std::string> &devnames)
+{
+    std::vector<std::string> removed;
+    for (auto const &gamepad : daemon_gamepads) {
+        if (std::find(devnames.begin(), devnames.end(), gamepad.first) == devnames.end()) {
+            removed.push_back(gamepad.first);
+        }
+    }
+    for (auto const &devname : removed) {
+        daemon_remove(devname);
+    }
+    for (auto const &devname : devnames) {
+        daemon_add(devname);
+    }
 }
 
 } // namespace sdlxboxmap
@@ -638,5 +1166,6 @@ int main(int argc, char* argv[]) {
     sdlxboxmap::MainApp app = sdlxboxmap::MainApp();
 
     app.arg_parse(argc, argv);
+    EvdevJoystick::finish_probes(PROBE_EXIT_TIMEOUT, EXIT_SUCCESS);
     return 0;
 }
@@ -1,11 +1,19 @@
 #ifndef _SDLXBOXMAP_H_INCLUDED__
 #define _SDLXBOXMAP_H_INCLUDED__
 
+#include <atomic>
 #include <memory>
+#include <chrono>
 #include <string_view>
 #include <cxxopts.hpp>
 #include <stdexcept>
+#include <map>
 #include "evdevjoy.h"
+#include "tplprogram.h"
+#include "probecache.h"
+#include "rendercache.h"
+#include "remapengine.h"
+#include "remappipeline.h"
 
 
 namespace sdlxboxmap {
@@ -22,37 +30,158 @@ class MainAppException : public std::runtime_error
 class MainApp
 {
   public:
-    // Maximum size of buffer and command lenght e.g.: <MAP_BUTTON:dpad_x> ,...*/
-    static const size_t BUFFER_SIZE = 50;
-
     evdevjoy::SDLJoyMapping joymap;
-    enum class e_mapping_result{ FOUND, NOT_FOUND, UNSUPPORTED };
+    // Mapping databases, option --db
+    std::vector<std::string> db_files;
+    // Number of rendering threads, option --jobs, 0 = number of CPUs
+    unsigned jobs = 0;
+    // Timeout of opening one gamepad, option --probe-timeout
+    std::chrono::milliseconds probe_timeout{2000};
+    // Enumerate gamepads from sysfs under this root, option --sysfs. Empty
+    // opens the event devices.
+    std::string sysfs_root;
+    // Device nodes of the gamepads and their by-path links, option
+    // --dev-root, derived from sysfs_root by default
+    std::string dev_root = "/dev/input";
+    // Gamepads loaded from the snapshots, option --from-snapshot
+    std::vector<std::string> snapshot_files;
+    // Probe cache file, option --probe-cache, empty disables the cache
+    std::string probe_cache_file;
+    // Render cache directory, option --render-cache, empty disables the cache
+    std::string render_cache_dir;
+    // Size limit of the render cache in bytes, option --render-cache-size
+    uint64_t render_cache_size = 64ull << 20;
+    // Trace replayed in place of the gamepads, option --replay
+    std::string replay_file;
+    // Option --replay-speed, 0 = maximum speed
+    double replay_speed = 1.0;
+    // Reader thread per gamepad, option --threaded
+    bool threaded = false;
+    // Ring size of one gamepad with --threaded, option --ring-frames
+    std::size_t ring_frames = evdevjoy::RemapPipeline::DEFAULT_RING_FRAMES;
 
     MainApp();
     void arg_parse(int argc, char* argv[]);
     void find_gamepads();
+    // Save the connected gamepads, option --snapshot
+    void save_snapshot(const std::string &filename);
+    // Open all event devices of the joysticks concurrently, nullptr for
+    // device which failed or timed out. With sysfs_root the gamepads are
+    // described by sysfs, no device is opened. With snapshot_files the
+    // gamepads are read from the snapshots.
+    std::vector<t_uptr_evdevjoystick> open_gamepads();
+    void load_mapping_db();
+    void compile_db(const std::string &in_filename, const std::string &out_filename);
+    static std::vector<evdevjoy::Guid> parse_guid_list(const std::vector<std::string> &values);
+    // Gamepad is in the guid list (when not empty) and not in the filter
+    static bool select_gamepad(const evdevjoy::Guid &guid_it, 
+        const std::vector<evdevjoy::Guid> &guid,
+        const std::vector<evdevjoy::Guid> &filter);
     void init_gamepads(
-        const std::vector<std::string> &guid,
-        const std::vector<std::string> &filter,
+        const std::vector<evdevjoy::Guid> &guid,
+        const std::vector<evdevjoy::Guid> &filter,
         std::vector<t_uptr_evdevjoystick> &gamepads);
-    void replace_mapping(evdevjoy::EvdevJoystick &gamepad, const std::string &tpl_filename, 
-        const std::string &out_filename);
+    // Template compiled on the first use, see TemplateProgram
+    const TemplateProgram& get_template(const std::string &tpl_filename);
+    // Render the template for the gamepad into out_filename, thread safe.
+    // The file is written only when its content changes, see update_file().
+    // Returns false when the file cannot be written.
+    bool replace_mapping(const evdevjoy::EvdevJoystick &gamepad, const TemplateProgram &program, 
+        const std::string &out_filename) const;
 
     void make_file_substitution(cxxopts::ParseResult &parsed_args);
-    void sreplace_mapping(evdevjoy::EvdevJoystick &gamepad, 
-        std::istream &is, std::ostream &os);
-    MainApp::e_mapping_result get_mapping_value(evdevjoy::EvdevJoystick &gamepad,
-        std::string_view map_command, std::string &result);
-    MainApp::e_mapping_result map_evdev(evdevjoy::EvdevJoystick &gamepad,
-        std::string &result);
-    MainApp::e_mapping_result map_abs(evdevjoy::EvdevJoystick &gamepad, 
-        std::string_view button_name, std::string &result);
-    MainApp::e_mapping_result map_button(evdevjoy::EvdevJoystick &gamepad, 
-        std::string_view button_name, std::string &result);
-    MainApp::e_mapping_result axismap(evdevjoy::EvdevJoystick &gamepad,
-        std::string_view button_name, std::string &result);
+    // Option --fleet: render the templates for every mapping (or the guids
+    // of -g) with synthetic device, see make_device_layout()
+    void run_fleet(cxxopts::ParseResult &parsed_args);
+    // Option --monitor: print the SDL events of the connected gamepads until
+    // all of them are disconnected or interrupted, see RemapEngine
+    void run_monitor(cxxopts::ParseResult &parsed_args);
+    // Option --remap: the same events written into uinput gamepads, the
+    // latency is printed at the end
+    void run_remap(cxxopts::ParseResult &parsed_args);
+    // Option --record: save the events of the connected gamepads into the
+    // trace until interrupted, see TraceWriter
+    void run_record(cxxopts::ParseResult &parsed_args);
+    // Option --replay without --monitor or --remap: the trace is remapped
+    // without output, the speed and the latency are printed
+    void run_replay(cxxopts::ParseResult &parsed_args);
+    // Option --daemon, never returns. Mapping database and templates stay
+    // loaded, the output of the gamepad is rendered on its arrival and
+    // removed on its removal, outputs of other gamepads are not touched.
+    void run_daemon(cxxopts::ParseResult &parsed_args);
 
   protected:
+    // Gamepad handled by the daemon
+    struct DaemonGamepad
+    {
+        evdevjoy::Guid guid;
+        std::size_t slot;           // index of the output file
+        std::string out_filename;
+    };
+
+    // Results of replace_mapping()
+    struct OutputStats
+    {
+        std::atomic<std::size_t> unchanged{0};
+        std::atomic<std::size_t> rewritten{0};
+        std::atomic<std::size_t> created{0};
+    };
+
+    std::map<std::string, TemplateProgram> templates;
+    mutable OutputStats output_stats;
+    std::unique_ptr<evdevjoy::ProbeCache> probe_cache;
+    std::unique_ptr<RenderCache> render_cache;
+    // Options -g, -f, -t, -d, -o
+    std::vector<evdevjoy::Guid> guid_select;
+    std::vector<evdevjoy::Guid> guid_filter;
+    std::string tpl_filename;
+    std::string tpl_dir;
+    std::string out_filename;
+    std::string out_filename_base;
+    std::string out_filename_ext;
+    // Daemon state, key is the device path
+    std::map<std::string, DaemonGamepad> daemon_gamepads;
+    std::vector<bool> daemon_slots;
+
+    void parse_output_args(cxxopts::ParseResult &parsed_args);
+    // Output file of the gamepad with the index (number suffix from 1)
+    std::string get_out_filename(std::size_t index) const;
+    // Template of the gamepad guid in the template directory, or the default
+    const TemplateProgram& get_gamepad_template(const evdevjoy::EvdevJoystick &gamepad);
+    // Open the devices, the device found in the probe cache is not opened
+    std::vector<t_uptr_evdevjoystick> probe_devices(const std::vector<std::string> &devnames);
+    // Open one gamepad, nullptr on failure
+    t_uptr_evdevjoystick open_gamepad(const std::string &devname);
+    // Gamepads of --monitor and --remap
+    std::vector<t_uptr_evdevjoystick> engine_gamepads;
+    std::unique_ptr<evdevjoy::EventMonitor> engine_monitor;
+    std::unique_ptr<evdevjoy::RemapEngine> engine;
+    std::unique_ptr<evdevjoy::RemapPipeline> pipeline;
+
+    // Open the connected gamepads (-g, -f), throws MainAppException when
+    // there is none
+    std::vector<t_uptr_evdevjoystick> open_engine_gamepads(cxxopts::ParseResult &parsed_args);
+    // Open the connected gamepads into engine_gamepads, watched by the
+    // returned monitor with the same indexes
+    std::unique_ptr<evdevjoy::EventMonitor> open_event_monitor(cxxopts::ParseResult &parsed_args);
+    // Pass the events to the handler until all gamepads are removed or
+    // SIGINT/SIGTERM
+    void run_event_loop(evdevjoy::EventMonitor &monitor, evdevjoy::EventHandler &handler);
+    // Translate the events of the connected gamepads, or of the replay_file,
+    // into the sink
+    const evdevjoy::LatencyStats& run_engine(cxxopts::ParseResult &parsed_args,
+        evdevjoy::EventSink &sink);
+    const evdevjoy::LatencyStats& replay_engine(evdevjoy::EventSink &sink);
+    // run_engine() with --threaded, see RemapPipeline
+    const evdevjoy::LatencyStats& run_pipeline(cxxopts::ParseResult &parsed_args,
+        evdevjoy::EventSink &sink);
+    void daemon_add(const std::string &devname);
+    void daemon_remove(const std::string &devname);
+    void daemon_rescan(const std::vector<std::string> &devnames);
+    // Print the counts of unchanged, rewritten and new outputs
+    void report_outputs() const;
+    // Log the render cache statistics and evict the old entries
+    void finish_render_cache();
     std::unique_ptr<cxxopts::Options> init_arg_parser();
   private:
     // Disable copy constructor and assign operator
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "snapshot.h"
+#include "stringext.h"
+
+namespace evdevjoy {
+
+static const char *SNAPSHOT_HEADER = "# sdlxboxmap device snapshot";
+
+// libevdev name of the event, the number when the code has no name
+static void write_events(std::ostream &os, const char *key, const std::vector<EventType> &events)
+{
+    os << key;
+    for (auto const &event : events) {
+        std::string_view name = event.get_name();
+        if (name.empty()) {
+            os << ' ' << event.code;
+        } else {
+            os << ' ' << name;
+        }
+    }
+    os << '\n';
+}
+
+void write_snapshot(std::ostream &os, const EvdevJoystick &gamepad)
+{
+    std::string name(gamepad.get_name());
+    std::replace(name.begin(), name.end(), '\n', ' ');
+
+    os << "device " << gamepad.devname << '\n'
+        << "guid " << gamepad.get_guid() << '\n'
+        << "name " << name << '\n';
+    write_events(os, "buttons", gamepad.buttons);
+
+    std::vector<EventType> hats;
+    for (auto const &hat : gamepad.hats) {
+        hats.push_back(hat.x);
+    }
+    write_events(os, "hats", hats);
+    write_events(os, "axes", gamepad.axes);
+}
+
+// Event code from the libevdev name or the number, -1 when unknown
+static int parse_event_code(unsigned int type, const std::string &token)
+{
+    if (!token.empty() && std::all_of(token.begin(), token.end(),
+            [](unsigned char c) { return std::isdigit(c); }))
+    {
+        try {
+            return string::to_int(token);
+        } catch (const std::exception&) {
+            return -1;
+        }
+    }
+    return libevdev_event_code_from_name(type, token.c_str());
+}
+
+std::vector<DeviceDescriptor> read_snapshot(std::istream &is)
+{
+    std::vector<DeviceDescriptor> devices;
+    std::string line;
+    std::size_t line_number = 0;
+
+    auto error = [&line_number](const std::string &message) {
+        return std::runtime_error("Snapshot line " + std::to_string(line_number) + ": " + message);
+    };
+
+    while (std::getline(is, line)) {
+        line_number++;
+        std::string text = string::strip(line);
+        if (text.empty() || (text[0] == '#')) {
+            continue;
+        }
+
+        std::vector<std::string> fields = string::split(text, 1);
+        const std::string &key = fields[0];
+        std::string value = (fields.size() > 1) ? fields[1] : "";
+
+        if (key == "device") {
+            devices.emplace_back();
+            devices.back().devname = value;
+            continue;
+        }
+        if (devices.empty()) {
+            throw error("'device' expected");
+        }
+
+        DeviceDescriptor &descriptor = devices.back();
+        if (key == "guid") {
+            Guid guid;
+            if (!Guid::from_string(value, guid)) {
+                throw error("wrong guid '" + value + "'");
+            }
+            if (!descriptor.set_guid(guid)) {
+                throw error("guid is not made from the evdev id: " + value);
+            }
+        } else if (key == "name") {
+            descriptor.name = value;
+        } else if ((key == "buttons") || (key == "hats") || (key == "axes")) {
+            unsigned int type = (key == "buttons") ? EV_KEY : EV_ABS;
+            for (auto const &token : string::split(value)) {
+                int code = parse_event_code(type, token);
+                bool is_hat = (code >= ABS_HAT0X) && (code <= ABS_HAT3Y);
+                if ((code < 0) || ((type == EV_KEY) && (code >= KEY_CNT)) ||
+                    ((type == EV_ABS) && (code >= ABS_CNT)))
+                {
+                    throw error("unknown event '" + token + "'");
+                }
+                if (key == "buttons") {
+                    descriptor.key_bits.set(code);
+                } else if (key == "hats") {
+                    if (!is_hat || ((code - ABS_HAT0X) % 2 != 0)) {
+                        throw error("hat must be ABS_HAT<n>X, not '" + token + "'");
+                    }
+                    descriptor.abs_bits.set(code);
+                    descriptor.abs_bits.set(code + 1);
+                } else {
+                    if (is_hat) {
+                        throw error("hat '" + token + "' in axes");
+                    }
+                    descriptor.abs_bits.set(code);
+                }
+            }
+        } else {
+            throw error("unknown key '" + key + "'");
+        }
+    }
+    return devices;
+}
+
+void write_snapshot_file(const std::string &filename,
+    const std::vector<std::unique_ptr<EvdevJoystick>> &gamepads)
+{
+    std::ofstream fout(filename, std::ios::out | std::ios::trunc);
+    if (!fout) {
+        throw std::runtime_error("Cannot create file '" + filename + "'");
+    }
+    fout << SNAPSHOT_HEADER << '\n';
+    for (auto const &gamepad : gamepads) {
+        if (gamepad) {
+            fout << '\n';
+            write_snapshot(fout, *gamepad);
+        }
+    }
+    fout.close();
+    if (!fout) {
+        throw std::runtime_error("Error during writing file '" + filename + "'");
+    }
+}
+
+std::vector<DeviceDescriptor> read_snapshot_file(const std::string &filename)
+{
+    std::ifstream fin(filename);
+    if (!fin) {
+        throw std::runtime_error("Cannot open snapshot '" + filename + "'");
+    }
+    try {
+        return read_snapshot(fin);
+    } catch (const std::runtime_error &e) {
+        throw std::runtime_error(filename + ": " + e.what());
+    }
+}
+
+} // namespace evdevjoy
@@ -0,0 +1,36 @@
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include "evdevjoy.h"
+
+namespace evdevjoy {
+
+// Device snapshot: the gamepad saved into text file (option --snapshot) and
+// loaded in place of the device (option --from-snapshot), the configuration
+// can be rendered without the hardware. One block per gamepad, the events
+// are written by the libevdev names in the SDL order:
+//
+//   device /dev/input/by-path/pci-0000:00:14.0-usb-0:1:1.0-event-joystick
+//   guid 030000005e0400008e02000010010000
+//   name Microsoft X-Box 360 pad
+//   buttons BTN_SOUTH BTN_EAST BTN_NORTH BTN_WEST BTN_TL BTN_TR ...
+//   hats ABS_HAT0X
+//   axes ABS_X ABS_Y ABS_Z ABS_RX ABS_RY ABS_RZ
+//
+// Empty lines and comments (#) are skipped.
+
+void write_snapshot(std::ostream &os, const EvdevJoystick &gamepad);
+// Throws std::runtime_error with the line number on wrong input
+std::vector<DeviceDescriptor> read_snapshot(std::istream &is);
+
+// Throws std::runtime_error
+void write_snapshot_file(const std::string &filename,
+    const std::vector<std::unique_ptr<EvdevJoystick>> &gamepads);
+std::vector<DeviceDescriptor> read_snapshot_file(const std::string &filename);
+
+} // namespace evdevjoy
+#endif
@@ -1,5 +1,7 @@
 #include <stdexcept>
 #include <cstring>
+#include <charconv>
+#include <cctype>
 #include "stringext.h"
 
 namespace string {
@@ -231,4 +233,31 @@ std::vector<std::string_view> rsplit(const std::string_view text,
     return result;
 }
 
-}
\ No newline at end of file
+int to_int(const std::string_view text, std::size_t *idx)
+{
+    const char *first = text.data();
+    const char *last = text.data() + text.size();
+
+    // Skip leading whitespaces and plus sign as std::stoi does
+    while ((first != last) && std::isspace(static_cast<unsigned char>(*first))) {
+        ++first;
+    }
+    if ((first != last) && (*first == '+')) {
+        ++first;
+    }
+
+    int value = 0;
+    std::from_chars_result result = std::from_chars(first, last, value);
+    if (result.ec == std::errc::invalid_argument) {
+        throw std::invalid_argument("to_int");
+    } else if (result.ec == std::errc::result_out_of_range) {
+        throw std::out_of_range("to_int");
+    }
+
+    if (idx != nullptr) {
+        *idx = result.ptr - text.data();
+    }
+    return value;
+}
+
+}
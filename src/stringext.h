@@ -31,6 +31,10 @@ namespace string {
     extern std::vector<std::string_view> rsplit(const std::string_view text, 
         const std::string_view sep, std::size_t maxsplit=-1);
 
+    // Same as std::stoi for base 10 without the temporary std::string,
+    // throws std::invalid_argument or std::out_of_range
+    extern int to_int(const std::string_view text, std::size_t *idx=nullptr);
+
     // Returns copy of original string with lowercase
     inline std::string lower(std::string text) {
         std::transform(text.begin(), text.end(), text.begin(), 
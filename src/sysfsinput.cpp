@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef ELPP_DEFAULT_LOGGER
+#   define ELPP_DEFAULT_LOGGER "evdevjoy"
+#endif
+#include "logging.h"
+
+#include "sysfsinput.h"
+#include "stringext.h"
+
+namespace fs = std::filesystem;
+
+namespace evdevjoy {
+
+// sysfs attribute is at most one page
+static const std::size_t ATTRIBUTE_SIZE = 4096;
+
+// Content of the sysfs attribute without the trailing new line
+static bool read_attribute(const std::string &filename, std::string &value)
+{
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    char buffer[ATTRIBUTE_SIZE];
+    std::size_t length = 0;
+    ssize_t n;
+    while (length < sizeof(buffer)) {
+        n = read(fd, buffer + length, sizeof(buffer) - length);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        length += n;
+    }
+    close(fd);
+
+    while ((length > 0) && (buffer[length-1] == '\n')) {
+        length--;
+    }
+    value.assign(buffer, length);
+    return true;
+}
+
+// Hexadecimal attribute of the id directory, e.g. "045e"
+static bool read_id(const std::string &filename, uint16_t &id)
+{
+    std::string value;
+    if (!read_attribute(filename, value) || value.empty()) {
+        return false;
+    }
+    char *end;
+    unsigned long number = std::strtoul(value.c_str(), &end, 16);
+    if ((*end != '\0') || (number > 0xffff)) {
+        return false;
+    }
+    id = static_cast<uint16_t>(number);
+    return true;
+}
+
+SysfsInput::SysfsInput(std::string sysfs_root, std::string dev_root)
+    : sysfs_root(std::move(sysfs_root)), dev_root(std::move(dev_root))
+{
+}
+
+std::vector<DeviceDescriptor> SysfsInput::get_joysticks() const
+{
+    std::error_code ec;
+
+    // eventN -> by-path link of the joystick, udev classification
+    std::map<std::string, std::string> links;
+    for (auto const &entry : fs::directory_iterator(dev_root + "/by-path", ec)) {
+        std::string filename = entry.path().u8string();
+        if (!string::endswith(filename, std::string("event-joystick"))) {
+            continue;
+        }
+        std::error_code link_ec;
+        fs::path target = fs::read_symlink(entry.path(), link_ec);
+        if (!link_ec) {
+            links[target.filename().u8string()] = filename;
+        }
+    }
+
+    const std::string class_path = sysfs_root + "/class/input";
+    fs::directory_iterator it_class(class_path, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot read directory '" + class_path + "': " + ec.message());
+    }
+
+    std::vector<std::pair<unsigned long, std::string>> events;
+    for (auto const &entry : it_class) {
+        std::string event_name = entry.path().filename().u8string();
+        if (!string::startswith(event_name, std::string("event"))) {
+            continue;
+        }
+        char *end;
+        unsigned long number = std::strtoul(event_name.c_str() + 5, &end, 10);
+        if ((*end == '\0') && (event_name.size() > 5)) {
+            events.emplace_back(number, event_name);
+        }
+    }
+    std::sort(events.begin(), events.end());
+
+    std::vector<DeviceDescriptor> joysticks;
+    for (auto const &event : events) {
+        DeviceDescriptor descriptor;
+        if (!read_descriptor(event.second, descriptor)) {
+            LOG(DEBUG) << "SysfsInput: skip " << event.second << ", cannot read attributes";
+            continue;
+        }
+
+        auto it_link = links.find(event.second);
+        if (it_link != links.end()) {
+            descriptor.devname = it_link->second;
+        } else if (is_joystick(descriptor)) {
+            descriptor.devname = dev_root + "/" + event.second;
+        } else {
+            continue;
+        }
+        LOG(DEBUG) << "SysfsInput: joystick " << event.second << ", " << descriptor.name;
+        joysticks.push_back(std::move(descriptor));
+    }
+    return joysticks;
+}
+
+bool SysfsInput::read_identity(const std::string &event_name, DeviceDescriptor &descriptor,
+        std::string &key_caps, std::string &abs_caps) const
+{
+    const std::string device_path = sysfs_root + "/class/input/" + event_name + "/device/";
+
+    return read_id(device_path + "id/bustype", descriptor.bustype) &&
+        read_id(device_path + "id/vendor", descriptor.vendor) &&
+        read_id(device_path + "id/product", descriptor.product) &&
+        read_id(device_path + "id/version", descriptor.version) &&
+        read_attribute(device_path + "name", descriptor.name) &&
+        read_attribute(device_path + "capabilities/key", key_caps) &&
+        read_attribute(device_path + "capabilities/abs", abs_caps);
+}
+
+bool SysfsInput::read_descriptor(const std::string &event_name, DeviceDescriptor &descriptor) const
+{
+    std::string key_caps, abs_caps;
+
+    return read_identity(event_name, descriptor, key_caps, abs_caps) &&
+        parse_bitmap(key_caps, descriptor.key_bits) && 
+        parse_bitmap(abs_caps, descriptor.abs_bits);
+}
+
+std::string SysfsInput::get_event_name(const std::string &devname)
+{
+    std::error_code ec;
+    std::string event_name = fs::canonical(devname, ec).filename().u8string();
+    if (ec || !string::startswith(event_name, std::string("event"))) {
+        return "";
+    }
+    return event_name;
+}
+
+bool SysfsInput::is_joystick(const DeviceDescriptor &descriptor)
+{
+    const Bitmap<KEY_CNT> &key_bits = descriptor.key_bits;
+    const Bitmap<ABS_CNT> &abs_bits = descriptor.abs_bits;
+
+    if (key_bits.test(BTN_TOUCH) || key_bits.test(BTN_TOOL_FINGER) ||
+        key_bits.test(BTN_TOOL_PEN) || key_bits.test(BTN_STYLUS))
+    {
+        return false;
+    }
+
+    // Joystick and gamepad buttons, BTN_TRIGGER_HAPPY buttons
+    if (key_bits.any(BTN_JOYSTICK, BTN_DIGI) ||
+        key_bits.any(BTN_TRIGGER_HAPPY1, BTN_TRIGGER_HAPPY40 + 1))
+    {
+        return true;
+    }
+
+    // Joystick axes, ABS_X and ABS_Y alone is a mouse like device
+    return abs_bits.test(ABS_X) && abs_bits.test(ABS_Y) &&
+        (abs_bits.test(ABS_RX) || abs_bits.test(ABS_RY) ||
+         abs_bits.test(ABS_THROTTLE) || abs_bits.test(ABS_RUDDER) ||
+         abs_bits.test(ABS_WHEEL) || abs_bits.test(ABS_GAS) || abs_bits.test(ABS_BRAKE));
+}
+
+} // namespace evdevjoy
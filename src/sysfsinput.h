@@ -0,0 +1,107 @@
+#ifndef __SYSFSINPUT_H
+#define __SYSFSINPUT_H
+
+#include <charconv>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "evdevjoy.h"
+
+namespace evdevjoy {
+
+// Enumeration of the joysticks from sysfs, the device nodes are not opened.
+// Identity, name and capabilities of the event device eventN are read from
+// <sysfs_root>/class/input/eventN/device/{id/*,name,capabilities/*}. The
+// roots are configurable, enumeration can be tested against a fake tree.
+class SysfsInput
+{
+  public:
+    explicit SysfsInput(std::string sysfs_root = "/sys", std::string dev_root = "/dev/input");
+
+    // Joysticks ordered by the event number. Device path is the by-path link
+    // of the joystick (same as EvdevJoystick::get_event_devices()), or
+    // <dev_root>/eventN when there is no link.
+    std::vector<DeviceDescriptor> get_joysticks() const;
+
+    // Read the event device (e.g. "event5"), false when the device is not
+    // present or its attributes cannot be parsed. devname is not set.
+    bool read_descriptor(const std::string &event_name, DeviceDescriptor &descriptor) const;
+    // Read id and name, the capabilities are returned unparsed (sysfs text)
+    bool read_identity(const std::string &event_name, DeviceDescriptor &descriptor,
+        std::string &key_caps, std::string &abs_caps) const;
+
+    // Event device name (e.g. "event5") of the device node or of the link
+    // to the node, empty when the node is not an event device
+    static std::string get_event_name(const std::string &devname);
+
+    // Joystick heuristic close to udev input_id: joystick buttons or axes,
+    // not a touchpad or tablet
+    static bool is_joystick(const DeviceDescriptor &descriptor);
+
+    // Parse capabilities bitmap: hex words separated by space, the most
+    // significant word first (kernel format of unsigned long words)
+    template <std::size_t NBITS>
+    static bool parse_bitmap(std::string_view text, Bitmap<NBITS> &bitmap);
+    // Format in the same way as the kernel, leading zero words are skipped
+    template <std::size_t NBITS>
+    static std::string format_bitmap(const Bitmap<NBITS> &bitmap);
+
+  protected:
+    std::string sysfs_root;
+    std::string dev_root;
+};
+
+template <std::size_t NBITS>
+bool SysfsInput::parse_bitmap(std::string_view text, Bitmap<NBITS> &bitmap)
+{
+    typedef Bitmap<NBITS> t_bitmap;
+    std::vector<unsigned long> words;   // most significant first
+
+    std::size_t i = 0;
+    while (i < text.size()) {
+        if ((text[i] == ' ') || (text[i] == '\n')) {
+            i++;
+            continue;
+        }
+        unsigned long word;
+        auto result = std::from_chars(text.data() + i, text.data() + text.size(), word, 16);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        words.push_back(word);
+        i = result.ptr - text.data();
+    }
+
+    bitmap = t_bitmap();
+    for (std::size_t i_word=0; (i_word < words.size()) && (i_word < t_bitmap::WORDS); i_word++) {
+        bitmap.words[i_word] = words[words.size() - 1 - i_word];
+    }
+    return !words.empty();
+}
+
+template <std::size_t NBITS>
+std::string SysfsInput::format_bitmap(const Bitmap<NBITS> &bitmap)
+{
+    typedef Bitmap<NBITS> t_bitmap;
+    std::size_t i_word = t_bitmap::WORDS - 1;
+    while ((i_word > 0) && (bitmap.words[i_word] == 0)) {
+        i_word--;
+    }
+
+    std::string text;
+    char buffer[2 * sizeof(unsigned long) + 1];
+    while (true) {
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), bitmap.words[i_word], 16);
+        text.append(buffer, result.ptr);
+        if (i_word == 0) {
+            break;
+        }
+        text += ' ';
+        i_word--;
+    }
+    return text;
+}
+
+} // namespace evdevjoy
+#endif
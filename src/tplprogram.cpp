@@ -0,0 +1,323 @@
+#include <istream>
+#include <iterator>
+#include <string>
+
+#include "logging.h"
+#include "tplprogram.h"
+
+using namespace evdevjoy;
+
+namespace sdlxboxmap {
+
+// Template names of the buttons and axes, compared case insensitive
+static constexpr auto MapButton2SDLButton = make_name_map(TemplateButtonNames);
+
+//////////////////////////////////////////////////////////////////////////
+// Compiler
+//////////////////////////////////////////////////////////////////////////
+
+TemplateProgram TemplateProgram::compile(std::string text)
+{
+    TemplateProgram program;
+    program.text = std::move(text);
+    program.compile_source();
+    return program;
+}
+
+TemplateProgram TemplateProgram::compile(std::istream &is)
+{
+    return compile(std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()));
+}
+
+TemplateProgram TemplateProgram::compile_file(const std::string &filename)
+{
+    TemplateProgram program;
+    program.file = platform::MappedFile(filename);
+    program.compile_source();
+    return program;
+}
+
+void TemplateProgram::compile_source()
+{
+    std::string_view source = get_source();
+
+    // Same lines as returned by std::getline()
+    std::size_t i_line = 0;
+    while (i_line < source.size()) {
+        std::size_t i_line_end = source.find('\n', i_line);
+        if (i_line_end == std::string_view::npos) {
+            i_line_end = source.size();
+        }
+        std::size_t i_begin = ops.size();
+        ops.push_back(Op{OpCode::BEGIN_LINE, false, ControllerButton::INVALID, 0, 0});
+        compile_line(i_line, i_line_end);
+        if (!can_fail(i_begin + 1)) {
+            ops.erase(ops.begin() + i_begin);
+        }
+        ops.push_back(Op{OpCode::END_LINE, false, ControllerButton::INVALID,
+            static_cast<uint32_t>(i_line_end), (i_line_end < source.size()) ? 1u : 0u});
+        i_line = i_line_end + 1;
+    }
+}
+
+// Line can be commented out, when it contains any mapping command
+bool TemplateProgram::can_fail(std::size_t i_first_op) const
+{
+    for (std::size_t i=i_first_op; i < ops.size(); i++) {
+        OpCode code = ops[i].code;
+        if ((code == OpCode::MAP_ABS) || (code == OpCode::MAP_BUTTON) || 
+            (code == OpCode::AXISMAP) || (code == OpCode::UNSUPPORTED)) 
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TemplateProgram::compile_line(std::size_t i_line, std::size_t i_line_end)
+{
+    std::string_view line = get_source().substr(0, i_line_end);
+    std::size_t i_start = i_line;
+    std::size_t i_cmd_start, i_cmd_end;
+
+    while ((i_cmd_start = line.find('<', i_start)) != std::string_view::npos) {
+        i_cmd_end = line.find('>', i_cmd_start + 1);
+        if (i_cmd_end == std::string_view::npos) {
+            break;
+        }
+        add_literal(i_start, i_cmd_start - i_start);
+        if (!add_command(i_cmd_start + 1, i_cmd_end - i_cmd_start - 1)) {
+            // Unknown command is kept in the output
+            add_literal(i_cmd_start, i_cmd_end - i_cmd_start + 1);
+        }
+        i_start = i_cmd_end + 1;
+    }
+    add_literal(i_start, i_line_end - i_start);
+}
+
+bool TemplateProgram::add_command(std::size_t i_command, std::size_t length)
+{
+    std::string_view command = get_source().substr(i_command, length);
+    std::size_t i_separator = command.find(':');
+    std::string_view name = command.substr(0, i_separator);
+
+    if (i_separator == std::string_view::npos) {
+        if (name == "MAP_EVDEV") {
+            ops.push_back(Op{OpCode::MAP_EVDEV, false, ControllerButton::INVALID, 0, 0});
+            return true;
+        }
+        return false;
+    }
+
+    Op op = {OpCode::LITERAL, false, ControllerButton::INVALID, 0, 0};
+    if (name == "MAP_ABS") {
+        op.code = OpCode::MAP_ABS;
+    } else if (name == "MAP_BUTTON") {
+        op.code = OpCode::MAP_BUTTON;
+    } else if (name == "AXISMAP") {
+        op.code = OpCode::AXISMAP;
+    } else {
+        return false;
+    }
+
+    std::size_t i_button = i_separator + 1;
+    std::string_view button_name = command.substr(i_button);
+    if (op.code == OpCode::AXISMAP) {
+        if (button_name.size() < 2) {
+            add_unsupported("Wrong axis name: " + std::string(button_name));
+            return true;
+        }
+        if ((button_name[0] == '+') || (button_name[0] == '-')) {
+            op.invert = (button_name[0] == '-');
+            button_name.remove_prefix(1);
+            i_button++;
+        }
+    }
+
+    const ControllerButton *button = MapButton2SDLButton.find(button_name);
+    if (button == nullptr) {
+        LOG(ERROR) << "Cannot find button mapping for: " << button_name;
+        add_unsupported("Unknown button: " + std::string(button_name));
+        return true;
+    }
+    op.button = *button;
+    op.offset = static_cast<uint32_t>(i_command + i_button);
+    op.length = static_cast<uint32_t>(button_name.size());
+    ops.push_back(op);
+    return true;
+}
+
+void TemplateProgram::add_literal(std::size_t offset, std::size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+    // Join with the previous literal when it continues in the text
+    if (!ops.empty() && (ops.back().code == OpCode::LITERAL) && 
+        (ops.back().offset + ops.back().length == offset)) 
+    {
+        ops.back().length += static_cast<uint32_t>(length);
+        return;
+    }
+    ops.push_back(Op{OpCode::LITERAL, false, ControllerButton::INVALID,
+        static_cast<uint32_t>(offset), static_cast<uint32_t>(length)});
+}
+
+void TemplateProgram::add_unsupported(std::string_view message)
+{
+    ops.push_back(Op{OpCode::UNSUPPORTED, false, ControllerButton::INVALID,
+        static_cast<uint32_t>(messages.size()), static_cast<uint32_t>(message.size())});
+    messages.append(message);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Commands, return false when the gamepad does not support the mapping
+//////////////////////////////////////////////////////////////////////////
+
+static bool map_abs(const EvdevJoystick &gamepad, ControllerButton button, 
+        std::string_view button_name, platform::IovecBuffer &out)
+{
+    EventButtonBinding event_binding = gamepad.get_event_binding(button);
+    if (!event_binding) {
+        LOG(ERROR) << "Unsupported gamepad button: " << button_name;
+        out.append("Unsupported gamepad mapping: ");
+        out.append(button_name);
+        return false;
+    }
+    if ( (event_binding.bind->input_type == BindType::BINDTYPE_AXIS) || 
+         (event_binding.bind->input_type == BindType::BINDTYPE_HAT)) {
+        out.append(event_binding.event->get_name());
+        return true;
+    }
+    LOG(WARNING) << "MAP_BUTTON: Error to map: " << button_name << "\n"
+        << "  button must be of the type axis or hat only";
+    out.append("ERROR ");
+    out.append(event_binding.event->get_name());
+    out.append(" is button");
+    return false;
+}
+
+static bool map_button(const EvdevJoystick &gamepad, ControllerButton button, 
+        std::string_view button_name, platform::IovecBuffer &out)
+{
+    EventButtonBinding event_binding = gamepad.get_event_binding(button);
+    if (!event_binding) {
+        LOG(ERROR) << "Unsupported gamepad button: " << button_name;
+        out.append("Unsupported gamepad mapping: ");
+        out.append(button_name);
+        return false;
+    }
+    if (event_binding.bind->input_type == BindType::BINDTYPE_BUTTON) {
+        out.append(event_binding.event->get_name());
+        return true;
+    }
+    LOG(WARNING) << "MAP_BUTTON: Error to map: " << button_name << "\n"
+        << "  button must be of the type button only (not hat, or axes)";
+    out.append("ERROR ");
+    out.append(event_binding.event->get_name());
+    out.append(" is axes");
+    return false;
+}
+
+static bool axismap(const EvdevJoystick &gamepad, ControllerButton button, bool invert_axis,
+        std::string_view button_name, platform::IovecBuffer &out)
+{
+    EventButtonBinding event_binding = gamepad.get_event_binding(button);
+    if (!event_binding) {
+        LOG(ERROR) << "Unsupported gamepad button: " << button_name;
+        out.append("Unsupported gamepad mapping: ");
+        out.append(button_name);
+        return false;
+    }
+
+    const ButtonBinding *bind = event_binding.bind;
+    bool found = false;
+    if (bind->input_type == BindType::BINDTYPE_AXIS) {
+        if (bind->output_type == BindType::BINDTYPE_AXIS) {
+            if (bind->output.axis_type == ControllerAxisType::HALF_AXIS_NEGATIVE) {
+                invert_axis = !invert_axis;
+            }
+        }
+        if (bind->input.invert_input) {
+            invert_axis = !invert_axis;
+        }
+        found = true;
+    } else if ((bind->input_type == BindType::BINDTYPE_HAT) && 
+            (bind->output_type == BindType::BINDTYPE_BUTTON)) {
+        if ( (bind->output.button == ControllerButton::BUTTON_DPAD_LEFT) && 
+            (bind->input.hat_mask == HatMask::RIGHT)) {
+                invert_axis = !invert_axis;
+        } else if ( (bind->output.button == ControllerButton::BUTTON_DPAD_RIGHT) && 
+            (bind->input.hat_mask == HatMask::LEFT)) {
+                invert_axis = !invert_axis;
+        } else if ( (bind->output.button == ControllerButton::BUTTON_DPAD_UP) && 
+            (bind->input.hat_mask == HatMask::DOWN)) {
+                invert_axis = !invert_axis;
+        } else if ( (bind->output.button == ControllerButton::BUTTON_DPAD_DOWN) && 
+            (bind->input.hat_mask == HatMask::UP)) {
+                invert_axis = !invert_axis;
+        }
+        found = true;
+    }
+
+    if (!found) {
+        LOG(ERROR) << "MAPAXIS: Unsupported mapping for: " << button_name << "\n"
+            << "Only axes or hats can be mapped.";
+    } else if (invert_axis) {
+        out.append("-");
+    }
+    out.append(button_name);
+    return found;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Renderer
+//////////////////////////////////////////////////////////////////////////
+
+void TemplateProgram::render(const EvdevJoystick &gamepad, platform::IovecBuffer &out) const
+{
+    std::size_t i_line = 0;
+    std::size_t line_size = 0;
+    bool supported = true;
+
+    for (const Op &op : ops) {
+        switch (op.code) {
+            case OpCode::LITERAL:
+                out.append(get_text(op));
+                break;
+            case OpCode::MAP_EVDEV:
+                out.append(gamepad.devname);
+                break;
+            case OpCode::MAP_ABS:
+                supported &= map_abs(gamepad, op.button, get_text(op), out);
+                break;
+            case OpCode::MAP_BUTTON:
+                supported &= map_button(gamepad, op.button, get_text(op), out);
+                break;
+            case OpCode::AXISMAP:
+                supported &= axismap(gamepad, op.button, op.invert, get_text(op), out);
+                break;
+            case OpCode::UNSUPPORTED:
+                out.append(std::string_view(messages).substr(op.offset, op.length));
+                supported = false;
+                break;
+            case OpCode::BEGIN_LINE:
+                i_line = out.mark();
+                line_size = out.size();
+                break;
+            case OpCode::END_LINE:
+                // Empty unsupported line is skipped
+                if (supported || (out.size() > line_size)) {
+                    if (!supported) {
+                        out.insert(i_line, "# ");
+                    }
+                    // New line of the template, or added to the last line
+                    out.append((op.length > 0) ? get_text(op) : std::string_view("\n"));
+                }
+                supported = true;
+                break;
+        }
+    }
+}
+
+} // namespace sdlxboxmap
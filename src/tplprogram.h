@@ -0,0 +1,141 @@
+#ifndef __TPLPROGRAM_H
+#define __TPLPROGRAM_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "evdevjoy.h"
+#include "mmapfile.h"
+#include "iovecbuffer.h"
+#include "namehash.h"
+
+namespace sdlxboxmap {
+
+// Names of the buttons and axes in the templates (lowercase), the aliases
+// of the older templates included
+inline constexpr evdevjoy::NameEntry<evdevjoy::ControllerButton> TemplateButtonNames[] = {
+    {"a", evdevjoy::ControllerButton::BUTTON_A},
+    {"b", evdevjoy::ControllerButton::BUTTON_B},
+    {"x", evdevjoy::ControllerButton::BUTTON_X},
+    {"y", evdevjoy::ControllerButton::BUTTON_Y},
+    {"back", evdevjoy::ControllerButton::BUTTON_BACK},
+    {"guide", evdevjoy::ControllerButton::BUTTON_GUIDE},
+    {"start", evdevjoy::ControllerButton::BUTTON_START},
+    {"tl", evdevjoy::ControllerButton::BUTTON_LEFTSTICK},
+    {"leftstick", evdevjoy::ControllerButton::BUTTON_LEFTSTICK},
+    {"tr", evdevjoy::ControllerButton::BUTTON_RIGHTSTICK},
+    {"rightstick", evdevjoy::ControllerButton::BUTTON_RIGHTSTICK},
+    {"lb", evdevjoy::ControllerButton::BUTTON_LEFTSHOULDER},
+    {"leftshoulder", evdevjoy::ControllerButton::BUTTON_LEFTSHOULDER},
+    {"rb", evdevjoy::ControllerButton::BUTTON_RIGHTSHOULDER},
+    {"rightshoulder", evdevjoy::ControllerButton::BUTTON_RIGHTSHOULDER},
+    {"dpad_y", evdevjoy::ControllerButton::BUTTON_DPAD_UP},
+    {"dpup", evdevjoy::ControllerButton::BUTTON_DPAD_UP},
+    {"duup", evdevjoy::ControllerButton::BUTTON_DPAD_UP},
+    {"du", evdevjoy::ControllerButton::BUTTON_DPAD_UP},
+    {"dpdown", evdevjoy::ControllerButton::BUTTON_DPAD_DOWN},
+    {"dd", evdevjoy::ControllerButton::BUTTON_DPAD_DOWN},
+    {"ddown", evdevjoy::ControllerButton::BUTTON_DPAD_DOWN},
+    {"dpad_x", evdevjoy::ControllerButton::BUTTON_DPAD_LEFT},
+    {"dpleft", evdevjoy::ControllerButton::BUTTON_DPAD_LEFT},
+    {"dlleft", evdevjoy::ControllerButton::BUTTON_DPAD_LEFT},
+    {"dl", evdevjoy::ControllerButton::BUTTON_DPAD_LEFT},
+    {"dpright", evdevjoy::ControllerButton::BUTTON_DPAD_RIGHT},
+    {"drright", evdevjoy::ControllerButton::BUTTON_DPAD_RIGHT},
+    {"dr", evdevjoy::ControllerButton::BUTTON_DPAD_RIGHT},
+    {"misc1", evdevjoy::ControllerButton::BUTTON_MISC1},
+    {"paddle1", evdevjoy::ControllerButton::BUTTON_PADDLE1},
+    {"paddle2", evdevjoy::ControllerButton::BUTTON_PADDLE2},
+    {"paddle3", evdevjoy::ControllerButton::BUTTON_PADDLE3},
+    {"paddle4", evdevjoy::ControllerButton::BUTTON_PADDLE4},
+    {"touchpad", evdevjoy::ControllerButton::BUTTON_TOUCHPAD},
+    {"x1", evdevjoy::ControllerButton::AXIS_LEFTX},
+    {"leftx", evdevjoy::ControllerButton::AXIS_LEFTX},
+    {"y1", evdevjoy::ControllerButton::AXIS_LEFTY},
+    {"lefty", evdevjoy::ControllerButton::AXIS_LEFTY},
+    {"x2", evdevjoy::ControllerButton::AXIS_RIGHTX},
+    {"rightx", evdevjoy::ControllerButton::AXIS_RIGHTX},
+    {"y2", evdevjoy::ControllerButton::AXIS_RIGHTY},
+    {"righty", evdevjoy::ControllerButton::AXIS_RIGHTY},
+    {"lt", evdevjoy::ControllerButton::AXIS_TRIGGERLEFT},
+    {"lefttrigger", evdevjoy::ControllerButton::AXIS_TRIGGERLEFT},
+    {"rt", evdevjoy::ControllerButton::AXIS_TRIGGERRIGHT},
+    {"righttrigger", evdevjoy::ControllerButton::AXIS_TRIGGERRIGHT},
+};
+
+// Configuration template compiled into a list of operations. The template is
+// scanned and the commands (<MAP_EVDEV>, <MAP_ABS:name>, <MAP_BUTTON:name>,
+// <AXISMAP:name>) are parsed only once by compile(), button names are
+// resolved to ControllerButton. render() only walks the operations, the
+// output references the template text, the template is not copied.
+//
+// Unknown commands are kept as literal text. Line with a command which
+// cannot be mapped for the gamepad is commented out with "# ".
+class TemplateProgram
+{
+  public:
+    enum class OpCode : uint8_t
+    {
+        LITERAL,        // text[offset, offset+length)
+        MAP_EVDEV,
+        MAP_ABS,
+        MAP_BUTTON,
+        AXISMAP,
+        UNSUPPORTED,    // error found by compile(), messages[offset, offset+length)
+        BEGIN_LINE,     // only before line which can be commented out
+        END_LINE        // text[offset, offset+length), "\n" or empty at the end
+    };
+
+    struct Op
+    {
+        OpCode code;
+        bool invert;                        // AXISMAP: name prefixed by '-'
+        evdevjoy::ControllerButton button;
+        uint32_t offset;                    // commands: button name in text
+        uint32_t length;
+    };
+
+    TemplateProgram() = default;
+    TemplateProgram(TemplateProgram &&other) = default;
+    TemplateProgram& operator=(TemplateProgram &&other) = default;
+
+    static TemplateProgram compile(std::string text);
+    static TemplateProgram compile(std::istream &is);
+    // Memory mapped template file, throws std::system_error
+    static TemplateProgram compile_file(const std::string &filename);
+
+    // Append the configuration for the gamepad to out. The output references
+    // the program and the gamepad, both must be valid until out is written.
+    void render(const evdevjoy::EvdevJoystick &gamepad, platform::IovecBuffer &out) const;
+
+    const std::vector<Op>& get_ops() const { return ops; }
+    std::string_view get_source() const {
+        return file.empty() ? std::string_view(text) : file.view();
+    }
+
+  protected:
+    platform::MappedFile file;  // template source, or
+    std::string text;
+    std::string messages;       // error messages of UNSUPPORTED operations
+    std::vector<Op> ops;
+
+    void compile_source();
+    void compile_line(std::size_t i_line, std::size_t i_line_end);
+    bool can_fail(std::size_t i_first_op) const;
+    bool add_command(std::size_t i_command, std::size_t length);
+    void add_literal(std::size_t offset, std::size_t length);
+    void add_unsupported(std::string_view message);
+    std::string_view get_text(const Op &op) const {
+        return get_source().substr(op.offset, op.length);
+    }
+
+  private:
+    // Disable copy constructor and assign operator
+    TemplateProgram(const TemplateProgram&) = delete;
+    TemplateProgram& operator=(const TemplateProgram&) = delete;
+};
+
+} // namespace sdlxboxmap
+#endif